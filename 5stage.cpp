@@ -1,65 +1,120 @@
 #include <unordered_map>
 #include <string>
-#include <functional>
 #include <vector>
-#include <fstream>
 #include <exception>
 #include <iostream>
-#include <boost/tokenizer.hpp>
+#include <chrono>
+#include <memory>
+#include <climits>
+#include "Program.hpp"
+#include "PerfCounters.hpp"
+#include "Profiler.hpp"
+#include "PipelineTrace.hpp"
+#include "HostProfiler.hpp"
+#include "BranchPredictor.hpp"
+#include "StateHash.hpp"
+#include "Devices.hpp"
+#include "CommandStream.hpp"
+#include "Mips32.hpp"
+#include "RunLimits.hpp"
+#include "Options.hpp"
 
 using namespace std;
 
+// a command that did not decode, it faults when it reaches ID
+const Opcode INVALID = NUM_OPCODES;
+// what a latch holds when it is not an instruction: nothing yet, a bubble, or the end of the program
+const Opcode EMPTY = Opcode(NUM_OPCODES + 1);
+const Opcode STALLED = Opcode(NUM_OPCODES + 2);
+const Opcode DONE = Opcode(NUM_OPCODES + 3);
+
 struct IF_ID_inter {
-	string reg1;
-	string reg2;
-	string reg3;
-	string opcode;
+	Instruction inst{EMPTY};
+	Kind kind;
+	long long id = -1;
 };
 
 struct ID_EX_inter {
-	string reg1;
-	string reg2;
-	string reg3;
-	string opcode;
-	int result;
-	int r1_val;
-	int r2_val;
-	int r3_val;
+	Instruction inst{EMPTY};
+	Kind kind;
+	// values of rs and rt
+	int rs_val;
+	int rt_val;
+	long long id = -1;
+	int pc;
 };
 
 struct EX_MEM_inter {
-	string reg1;
-	string reg2;
+	Instruction inst{EMPTY};
+	Kind kind;
 	int result;
 	int data;
-	string opcode;
+	long long id = -1;
+	int pc;
 };
 
 struct MEM_WB_inter {
-	string reg1;
+	Instruction inst{EMPTY};
+	Kind kind;
 	int data;
 	int result;
-	string opcode;
+	long long id = -1;
+	int pc;
+};
+
+// how decode handles an operand that is still being computed. each policy instantiates its own copy
+// of the pipeline so the choice costs nothing per cycle
+struct StallPolicy {
+	// wait until the producer has written the register back
+	static constexpr bool forwarding = false;
+	static constexpr bool predict = false;
+};
+
+struct ForwardingPolicy {
+	// take results from EX/MEM and MEM/WB, stall only for a value still being loaded
+	static constexpr bool forwarding = true;
+	static constexpr bool predict = false;
 };
 
+struct PredictorPolicy {
+	// as forwarding, but a branch waiting for a load follows a 2-bit predictor and resolves in EX
+	static constexpr bool forwarding = true;
+	static constexpr bool predict = true;
+};
+
+template <class Hazard>
 struct MIPS_Architecture
 {
-	int registers[32] = {0}, PCcurr = 0, PCnext;
-	unordered_map<string, function<int(MIPS_Architecture &, string, string, string)>> instructions;
-	unordered_map<string, int> registerMap, address;
-	static const int MAX = (1 << 20);
-	int data[MAX >> 2] = {0};
-	unordered_map<int, int> memoryDelta;
-	vector<vector<string>> commands;
-	vector<int> commandCount;
-	enum exit_code
-	{
-		SUCCESS = 0,
-		INVALID_REGISTER,
-		INVALID_LABEL,
-		INVALID_ADDRESS,
-		SYNTAX_ERROR,
-		MEMORY_ERROR
+	int registers[NUM_REGISTERS] = {0}, PCcurr = 0, PCnext;
+	unordered_map<string, int> address;
+	static const int DEFAULT_MEMORY = 1 << 20;
+	// bytes of data memory
+	int memoryBytes;
+	vector<int> data;
+	MemoryDelta memoryDelta;
+	// registers and memory, kept up to date by writeRegister and storeWord
+	StateHash stateHash;
+	// the last SIZE bytes of memory, the console writes to stderr
+	Devices devices;
+	int lastDeviceRead = 0;
+	// when set, device loads return this value and device stores are dropped: the functional model
+	// under --check replays what the pipeline read instead of touching the devices a second time
+	const int *deviceReads = nullptr;
+	CommandStream commands;
+	// counts per instruction are only kept when a profile is written
+	Profiler profile;
+	bool profiling = false;
+
+	// what is wrong with the program and where: the operand at line:column of instruction pc,
+	// found when it was loaded or, for a bad address or jump, in the given cycle
+	struct ProgramError
+	{
+		int code = Program::SUCCESS;
+		int pc = -1;
+		int line = 0;
+		int column = 0;
+		int cycle = 0;
+		string reason;
 	};
 
 	IF_ID_inter IF_ID;
@@ -70,7 +125,10 @@ struct MIPS_Architecture
 	bool stall = false;
 
 	int clockCycles;
-	int exitcode;
+	// the first error in the loaded program, and the one that stopped the run
+	ProgramError loadError;
+	ProgramError fault;
+	string sourceName;
 
 	bool valid_if = false;
 	bool valid_id = false;
@@ -78,327 +136,325 @@ struct MIPS_Architecture
 	bool valid_mem = false;
 	bool valid_wb = false;
 
-	unordered_map<string, int> occupied;
-
-	// constructor to initialise the instruction set
-	MIPS_Architecture(ifstream &file)
+	PerfCounters perf;
+	// register the instruction held in decode is waiting for
+	int hazard;
+	string statsPath;
+	string profilePath;
+	// the state printed every cycle, once at the end or not at all
+	enum OutputMode
 	{
-		instructions = {{"add", &MIPS_Architecture::add}, {"sub", &MIPS_Architecture::sub}, {"mul", &MIPS_Architecture::mul}, {"beq", &MIPS_Architecture::beq}, {"bne", &MIPS_Architecture::bne}, {"slt", &MIPS_Architecture::slt}, {"j", &MIPS_Architecture::j}, {"lw", &MIPS_Architecture::lw}, {"sw", &MIPS_Architecture::sw}, {"addi", &MIPS_Architecture::addi}};
+		OUTPUT_CYCLES,
+		OUTPUT_FINAL,
+		OUTPUT_NONE
+	} output = OUTPUT_CYCLES;
+	PipelineTrace trace;
+	// last instruction whose stall went into the trace
+	long long tracedStall = -1;
 
-		for (int i = 0; i < 32; ++i)
-			registerMap["$" + to_string(i)] = i;
-		registerMap["$zero"] = 0;
-		registerMap["$at"] = 1;
-		registerMap["$v0"] = 2;
-		registerMap["$v1"] = 3;
-		for (int i = 0; i < 4; ++i)
-			registerMap["$a" + to_string(i)] = i + 4;
-		for (int i = 0; i < 8; ++i)
-			registerMap["$t" + to_string(i)] = i + 8, registerMap["$s" + to_string(i)] = i + 16;
-		registerMap["$t8"] = 24;
-		registerMap["$t9"] = 25;
-		registerMap["$k0"] = 26;
-		registerMap["$k1"] = 27;
-		registerMap["$gp"] = 28;
-		registerMap["$sp"] = 29;
-		registerMap["$s8"] = 30;
-		registerMap["$ra"] = 31;
+	// writes in flight to each register and the number of registers with any, stall policy only
+	int occupied[NUM_REGISTERS] = {0};
+	int occupiedCount = 0;
+
+	// the branch decoded ahead of its load operand, predictor policy only
+	unique_ptr<BranchPredictor> predictor = make_unique<SaturatingBranchPredictor>(1);
+	bool speculating = false;
+	int speculativePC;
+	int speculativeTarget;
+	bool predictedTaken;
+	// which operands come from the load ahead of the branch
+	bool waiting1;
+	bool waiting2;
+
+	// the program is encoded into the bottom of data memory, where loads read it and stores rewrite it
+	bool unified = false;
+	// byte address of instruction 0 and data word 0, and the byte order of sub-word accesses. an ELF
+	// executable sets both, assembly text runs from address 0 big-endian
+	uint32_t base = 0;
+	bool bigEndian = true;
+
+	// functional model stepped once per retirement and compared against the pipeline, --check only
+	MIPS_Architecture *golden = nullptr;
+	bool diverged = false;
+
+	// instructions through WB, the budgets the run is held to and how it ended
+	long long retirements = 0;
+	RunLimits limits;
+	LoopWatchdog watchdog;
+	RunResult result;
+	chrono::steady_clock::time_point started;
 
+	MIPS_Architecture(MappedFile &file, int memoryBytes = DEFAULT_MEMORY)
+		: memoryBytes(memoryBytes), data(memoryBytes >> 2), memoryDelta(memoryBytes >> 2), devices(memoryBytes, cerr)
+	{
 		constructCommands(file);
-		commandCount.assign(commands.size(), 0);
+		devices.dataStart = dataStart();
 	}
 
-    int add(std::string r1, std::string r2, std::string r3)
+	MIPS_Architecture(const Program &program, int memoryBytes = DEFAULT_MEMORY)
+		: memoryBytes(memoryBytes), data(memoryBytes >> 2), memoryDelta(memoryBytes >> 2), devices(memoryBytes, cerr)
 	{
-		return op(r1, r2, r3, [&](int a, int b)
-				  { return a + b; });
+		constructCommands(program);
+		devices.dataStart = dataStart();
 	}
 
-	// perform subtraction operation
-	int sub(std::string r1, std::string r2, std::string r3)
+	// run instruction PCcurr on its own and set PCnext, the functional model under --check.
+	// returns the exit code
+	int execute(const Instruction &inst)
 	{
-		return op(r1, r2, r3, [&](int a, int b)
-				  { return a - b; });
+		PCnext = PCcurr + 1;
+		if (inst.isBranch())
+		{
+			if (branchTaken(inst, registers[inst.rs], registers[inst.rt]))
+				PCnext = inst.target;
+			return Program::SUCCESS;
+		}
+		if (inst.opcode == OP_J)
+		{
+			PCnext = inst.target;
+			return Program::SUCCESS;
+		}
+		// the end of the program is a valid target
+		if (inst.opcode == OP_JR)
+		{
+			PCnext = jumpTarget(registers[inst.rs]);
+			if (PCnext < 0)
+				return Program::INVALID_ADDRESS;
+			return Program::SUCCESS;
+		}
+		if (inst.isMemory())
+		{
+			int address = effectiveAddress(inst.rs, inst.imm, inst.accessSize());
+			if (address < 0)
+				return -address;
+			if (inst.isLoad())
+				writeRegister(inst.rd, load(inst, address));
+			else
+				store(inst, address, registers[inst.rt]);
+			return Program::SUCCESS;
+		}
+		if (inst.opcode == OP_JAL)
+			PCnext = inst.target;
+		int a = registers[inst.rs], b = registers[inst.rt];
+		writeRegister(inst.rd, aluResult(inst, a, b));
+		if (inst.opcode == OP_DIV)
+			writeRegister(REG_HI, aluResult2(inst, a, b));
+		return Program::SUCCESS;
 	}
 
-	// perform multiplication operation
-	int mul(std::string r1, std::string r2, std::string r3)
+	// write a memory word, recording the change for the cycle's output and in the running hash
+	void storeWord(int index, int value)
 	{
-		return op(r1, r2, r3, [&](int a, int b)
-				  { return a * b; });
+		if (data[index] == value)
+			return;
+		stateHash.update(index, data[index], value);
+		memoryDelta.insert(index);
+		data[index] = value;
+		if (unified && index < commands.size())
+			invalidate(index);
 	}
 
-	// perform the binary operation
-	int op(std::string r1, std::string r2, std::string r3, std::function<int(int, int)> operation)
+	// lowest byte address data accesses may use
+	int dataStart()
 	{
-		if (!checkRegisters({r1, r2, r3}) || registerMap[r1] == 0)
-			return 1;
-		registers[registerMap[r1]] = operation(registers[registerMap[r2]], registers[registerMap[r3]]);
-		PCnext = PCcurr + 1;
-		return 0;
+		return unified ? 0 : 4 * commands.size();
 	}
 
-	// perform the beq operation
-	int beq(std::string r1, std::string r2, std::string label)
+	// the word at an aligned byte address, from memory or a device
+	int loadWord(int address)
 	{
-		return bOP(r1, r2, label, [](int a, int b)
-				   { return a == b; });
+		if (!devices.contains(address))
+			return data[address / 4];
+		if (deviceReads)
+			return *deviceReads;
+		return lastDeviceRead = devices.read(address);
 	}
 
-	// perform the bne operation
-	int bne(std::string r1, std::string r2, std::string label)
+	void storeTo(int address, int value)
 	{
-		return bOP(r1, r2, label, [](int a, int b)
-				   { return a != b; });
+		if (!devices.contains(address))
+			storeWord(address / 4, value);
+		else if (!deviceReads)
+			devices.write(address, value);
 	}
 
-	// implements beq and bne by taking the comparator
-	int bOP(std::string r1, std::string r2, std::string label, std::function<bool(int, int)> comp)
+	// $zero stays zero, a write to it is dropped as on real MIPS
+	void writeRegister(int reg, int value)
 	{
-		if (!checkLabel(label))
-			return 4;
-		if (address.find(label) == address.end() || address[label] == -1)
-			return 2;
-		if (!checkRegisters({r1, r2}))
-			return 1;
-		PCnext = comp(registers[registerMap[r1]], registers[registerMap[r2]]) ? address[label] : PCcurr + 1;
-		return 0;
+		if (reg == 0)
+			return;
+		stateHash.update(StateHash::REGISTERS + reg, registers[reg], value);
+		registers[reg] = value;
 	}
 
-	// implements slt operation
-	int slt(std::string r1, std::string r2, std::string r3)
+	// a single add of the decoded operand and a bounds check, the byte offset into memory or minus the exit code
+	int effectiveAddress(int baseRegister, int offset, int size)
 	{
-		if (!checkRegisters({r1, r2, r3}) || registerMap[r1] == 0)
-			return 1;
-		registers[registerMap[r1]] = registers[registerMap[r2]] < registers[registerMap[r3]];
-		PCnext = PCcurr + 1;
-		return 0;
+		int address = int(uint32_t(registers[baseRegister]) + offset - base);
+		if (address % size || address < dataStart() || address >= memoryBytes || (size != 4 && devices.contains(address)))
+			return -Program::INVALID_ADDRESS;
+		return address;
 	}
 
-	// perform the jump operation
-	int j(std::string label, std::string unused1 = "", std::string unused2 = "")
+	// the value a load reads from a valid address
+	int load(const Instruction &inst, int address)
 	{
-		if (!checkLabel(label))
-			return 4;
-		if (address.find(label) == address.end() || address[label] == -1)
-			return 2;
-		PCnext = address[label];
-		return 0;
+		return loadResult(inst, loadWord(address - address % 4), address % 4, bigEndian);
 	}
 
-	// perform load word operation
-	int lw(std::string r, std::string location, std::string unused1 = "")
+	// write the bytes a store covers at a valid address
+	void store(const Instruction &inst, int address, int value)
 	{
-		if (!checkRegister(r) || registerMap[r] == 0)
-			return 1;
-		int address = locateAddress(location);
-		if (address < 0)
-			return abs(address);
-		registers[registerMap[r]] = data[address];
-		PCnext = PCcurr + 1;
-		return 0;
+		storeTo(address - address % 4, storeResult(inst, data[address / 4], value, address % 4, bigEndian));
 	}
 
-	// perform store word operation
-	int sw(std::string r, std::string location, std::string unused1 = "")
+	// print what stopped the program, nothing if it ran to the end
+	void handleExit(const ProgramError &error)
 	{
-		if (!checkRegister(r))
-			return 1;
-		int address = locateAddress(location);
-		if (address < 0)
-			return abs(address);
-		if (data[address] != registers[registerMap[r]])
-			memoryDelta[address] = registers[registerMap[r]];
-		data[address] = registers[registerMap[r]];
-		PCnext = PCcurr + 1;
-		return 0;
+		if (output == OUTPUT_CYCLES)
+			cout << '\n';
+		Program::printExitMessage(error.code);
+		if (error.code == Program::SUCCESS)
+			return;
+		result.status = RunResult::PROGRAM_ERROR;
+		result.code = error.code;
+		result.pc = error.pc;
+		result.reason = error.reason;
+		cerr << sourceName << ':';
+		if (error.line > 0)
+			cerr << error.line << ':' << error.column << ':';
+		cerr << ' ' << error.reason;
+		if (error.cycle > 0)
+			cerr << " in cycle " << error.cycle;
+		cerr << '\n';
+		if (error.pc >= 0 && commands.has(error.pc))
+			cerr << "    " << commandText(error.pc) << '\n';
 	}
 
-    int addi(std::string r1, std::string r2, std::string num)
+	// an error at operand k of instruction pc
+	ProgramError problem(int pc, int k, int code, const string &reason)
 	{
-		if (!checkRegisters({r1, r2}) || registerMap[r1] == 0)
-			return 1;
-		try
-		{
-			registers[registerMap[r1]] = registers[registerMap[r2]] + stoi(num);
-			PCnext = PCcurr + 1;
-			return 0;
-		}
-		catch (std::exception &e)
+		ProgramError error;
+		error.code = code;
+		error.pc = pc;
+		error.reason = reason;
+		if (commands.has(pc))
 		{
-			return 4;
+			error.line = commands.lineOf(pc);
+			error.column = commands.command(pc).column[k];
 		}
+		return error;
 	}
 
-	int locateAddress(string location)
+	// stop the run at the end of this cycle with an error only the running program can cause
+	void trap(int pc, int k, int code, const string &reason)
 	{
-		if (location.back() == ')')
-		{
-			try
-			{
-				int lparen = location.find('('), offset = stoi(lparen == 0 ? "0" : location.substr(0, lparen));
-				string reg = location.substr(lparen + 1);
-				reg.pop_back();
-				if (!checkRegister(reg))
-					return -3;
-				int address = registers[registerMap[reg]] + offset;
-				if (address % 4 || address < int(4 * commands.size()) || address >= MAX)
-					return -3;
-				return address / 4;
-			}
-			catch (exception &e)
-			{
-				return -4;
-			}
-		}
-		try
-		{
-			int address = stoi(location);
-			if (address % 4 || address < int(4 * commands.size()) || address >= MAX)
-				return -3;
-			return address / 4;
-		}
-		catch (exception &e)
-		{
-			return -4;
-		}
+		if (fault.code != Program::SUCCESS)
+			return;
+		fault = problem(pc, k, code, reason);
+		fault.cycle = clockCycles;
 	}
 
-	// checks if label is valid
-	inline bool checkLabel(string str)
+	// check command pc was decoded without error and resolve its label, so the pipeline never meets
+	// a malformed instruction. returns the problem, if any
+	ProgramError decode(int pc)
 	{
-		return str.size() > 0 && isalpha(str[0]) && all_of(++str.begin(), str.end(), [](char c)
-														   { return (bool)isalnum(c); }) &&
-			   instructions.find(str) == instructions.end();
+		CommandStream::Command &command = commands.command(pc);
+		command.checked = true;
+		if (command.error.code != Program::SUCCESS)
+			return problem(pc, command.error.operand, command.error.code, command.error.reason);
+		if (command.label.empty())
+			return ProgramError();
+		command.inst.target = labelAddress(command.label);
+		if (command.inst.target < 0)
+			return problem(pc, command.inst.isBranch() ? 3 : 1, Program::INVALID_LABEL, "label '" + command.label + "' is not defined or defined more than once");
+		return ProgramError();
 	}
 
-	// checks if the register is a valid one
-	inline bool checkRegister(string r)
+	// an instruction to jump to, or the end of the program
+	bool validTarget(int pc)
 	{
-		return registerMap.find(r) != registerMap.end();
+		return pc >= 0 && (commands.has(pc) || (commands.complete() && pc == commands.size()));
 	}
 
-	// checks if all of the registers are valid or not
-	bool checkRegisters(vector<string> regs)
+	// the instruction at the byte address jr goes to, -1 if there is none
+	int jumpTarget(int address)
 	{
-		return all_of(regs.begin(), regs.end(), [&](string r)
-						   { return checkRegister(r); });
+		int offset = int(uint32_t(address) - base);
+		return offset % 4 || !validTarget(offset / 4) ? -1 : offset / 4;
 	}
 
-	/*
-		handle all exit codes:
-		0: correct execution
-		1: register provided is incorrect
-		2: invalid label
-		3: unaligned or invalid address
-		4: syntax error
-		5: commands exceed memory limit
-	*/
-	void handleExit(exit_code code, int cycleCount)
+	// the command a label marks, -1 if it is undefined or defined twice. a streamed program is read
+	// ahead until the label turns up
+	int labelAddress(const string &label)
 	{
-		cout << '\n';
-		switch (code)
-		{
-		case 1:
-			cerr << "Invalid register provided or syntax error in providing register\n";
-			break;
-		case 2:
-			cerr << "Label used not defined or defined too many times\n";
-			break;
-		case 3:
-			cerr << "Unaligned or invalid memory address specified\n";
-			break;
-		case 4:
-			cerr << "Syntax error encountered\n";
-			break;
-		case 5:
-			cerr << "Memory limit exceeded\n";
-			break;
-		default:
-			break;
-		}
-		if (code != 0)
-		{
-			cerr << "Error encountered at:\n";
-			for (auto &s : commands[PCcurr])
-				cerr << s << ' ';
-			cerr << '\n';
-		}
+		auto it = address.find(label);
+		for (bool more = true; it == address.end() && more; it = address.find(label))
+			more = commands.pull();
+		return it == address.end() ? -1 : it->second;
 	}
 
-	// parse the command assuming correctly formatted MIPS instruction (or label)
-	void parseCommand(string line)
+	// decode the commands from the input file in a single pass over the mapped buffer, then check
+	// them and resolve their labels
+	void constructCommands(MappedFile &file)
 	{
-		// strip until before the comment begins
-		line = line.substr(0, line.find('#'));
-		vector<string> command;
-		boost::tokenizer<boost::char_separator<char>> tokens(line, boost::char_separator<char>(", \t"));
-		for (auto &s : tokens)
-			command.push_back(s);
-		// empty line or a comment only line
-		if (command.empty())
-			return;
-		else if (command.size() == 1)
+		HOST_TIMER(PARSE);
+		Assembler assembler;
+		assembler.parse(file.view(), [](const Tokens &) {});
+		for (size_t i = 0; i < assembler.commands.size(); ++i)
 		{
-			string label = command[0].back() == ':' ? command[0].substr(0, command[0].size() - 1) : "?";
-			if (address.find(label) == address.end())
-				address[label] = commands.size();
-			else
-				address[label] = -1;
-			command.clear();
+			const char *lineStart = assembler.commands[i][0].data();
+			while (lineStart > file.data && lineStart[-1] != '\n')
+				--lineStart;
+			commands.push(assembler.commands[i], assembler.lineOf[i], lineStart);
 		}
-		else if (command[0].back() == ':')
+		for (auto &label : assembler.address)
+			address[string(label.first)] = label.second;
+		for (int pc = 0; pc < commands.size(); ++pc)
 		{
-			string label = command[0].substr(0, command[0].size() - 1);
-			if (address.find(label) == address.end())
-				address[label] = commands.size();
-			else
-				address[label] = -1;
-			command = vector<string>(command.begin() + 1, command.end());
+			ProgramError error = decode(pc);
+			if (loadError.code == Program::SUCCESS)
+				loadError = error;
 		}
-		else if (command[0].find(':') != string::npos)
+	}
+
+	// take the instructions of a pre-assembled image or an ELF executable, which carry no source text,
+	// with the data and registers they start with. a stack set up by the loader begins below the devices
+	void constructCommands(const Program &program)
+	{
+		base = program.base;
+		bigEndian = program.bigEndian;
+		PCcurr = program.entry;
+		if (program.exitcode != Program::SUCCESS)
 		{
-			int idx = command[0].find(':');
-			string label = command[0].substr(0, idx);
-			if (address.find(label) == address.end())
-				address[label] = commands.size();
-			else
-				address[label] = -1;
-			command[0] = command[0].substr(idx + 1);
+			loadError.code = program.exitcode;
+			loadError.pc = program.errorPC;
+			loadError.reason = "the image or executable could not be loaded";
+			return;
 		}
-		else if (command[1][0] == ':')
+		for (const Instruction &inst : program.code)
+			commands.push(inst, textOf(inst));
+		for (int reg = 1; reg < 32; ++reg)
+			writeRegister(reg, program.initialRegisters[reg]);
+		if (registers[29])
+			writeRegister(29, int(base + devices.base - 16));
+		for (auto &word : program.initialData)
 		{
-			if (address.find(command[0]) == address.end())
-				address[command[0]] = commands.size();
-			else
-				address[command[0]] = -1;
-			command[1] = command[1].substr(1);
-			if (command[1] == "")
-				command.erase(command.begin(), command.begin() + 2);
-			else
-				command.erase(command.begin(), command.begin() + 1);
+			if (word.first >= devices.base / 4)
+			{
+				loadError.code = Program::MEMORY_ERROR;
+				loadError.reason = "initial data at byte " + to_string(base + 4 * word.first) + " is outside data memory";
+				return;
+			}
+			stateHash.update(word.first, data[word.first], word.second);
+			data[word.first] = word.second;
 		}
-		if (command.empty())
-			return;
-		if (command.size() > 4)
-			for (int i = 4; i < (int)command.size(); ++i)
-				command[3] += " " + command[i];
-		command.resize(4);
-		commands.push_back(command);
-	}
-
-	// construct the commands vector from the input file
-	void constructCommands(ifstream &file)
-	{
-		string line;
-		while (getline(file, line))
-			parseCommand(line);
-		file.close();
 	}
 
 	// print the register data in hexadecimal
 	void printRegistersAndMemoryDelta(int clockCycle)
 	{
+		HOST_TIMER(OUTPUT);
 		for (int i = 0; i < 32; ++i)
 			cout << registers[i] << ' ';
 		cout << '\n';
@@ -411,347 +467,640 @@ struct MIPS_Architecture
 		else{
 			cout << ' ';
 		}
-		for (auto &p : memoryDelta)
-			cout << p.first << ' ' << p.second << '\n';
+		for (int index : memoryDelta)
+			cout << index << ' ' << data[index] << '\n';
 		memoryDelta.clear();
 	}
 
+	// the registers and every nonzero memory word, laid out like one cycle of the full output
+	void printFinalState()
+	{
+		for (int i = 0; i < 32; ++i)
+			cout << registers[i] << ' ';
+		cout << '\n';
+		vector<int> words;
+		for (int i = 0; i < (memoryBytes >> 2); ++i)
+			if (data[i] != 0)
+				words.push_back(i);
+		cout << words.size() << (words.empty() ? '\n' : ' ');
+		for (int index : words)
+			cout << index << ' ' << data[index] << '\n';
+	}
+
 	// Add instruction pipeline stages
 	void IF_Stage() {
+		HOST_TIMER(IF);
 		// Fetch instruction from memory
-		if(PCcurr < commands.size()){
+		if(commands.has(PCcurr)){
 			if(stall){
 				return;
 			}
-			vector<string> &command = commands[PCcurr];
-			if (instructions.find(command[0]) == instructions.end())
-			{
-				handleExit(SYNTAX_ERROR, clockCycles);
-				return;
+			if(commands.streaming()){
+				commands.release(speculating ? min(PCcurr, speculativePC) : PCcurr);
+			}
+			if(commands.command(PCcurr).stale){
+				reload(PCcurr);
+			}
+			CommandStream::Command &command = commands.command(PCcurr);
+			IF_ID.inst = command.inst;
+			IF_ID.kind = command.kind;
+			perf.busy[PerfCounters::IF] = true;
+			if(trace.enabled){
+				IF_ID.id = trace.fetch(PCcurr, commandText(PCcurr));
 			}
-			IF_ID.opcode = command[0];
-			IF_ID.reg1 = command[1];
-			IF_ID.reg2 = command[2];
-			IF_ID.reg3 = command[3];
-			// cout << "IF_Stage" << "\n";
-			// cout << "opcode : " << command[0] << "\n";
-			// cout << "r1 : " << command[1] << "\n";
-			// cout << "r2 : " << command[2] << "\n";
-			// cout << "r3 : " << command[3] << "\n";
+		}
+		else if(speculating){
+			// the end of the program is only reached once the branch ahead has resolved
+			IF_ID.inst.opcode = EMPTY;
+			return;
 		}
 		else{
 			valid_if = true;
-			IF_ID.opcode = "done";
+			IF_ID.inst.opcode = DONE;
 			return;
 		}
 	}
 
 	void ID_Stage() {
+		HOST_TIMER(ID);
 		// Decode instruction
-		if(IF_ID.opcode == ""){
+		if(IF_ID.inst.opcode == EMPTY){
+			// a squashed or held fetch, what EX has just run must not run twice
+			ID_EX.inst.opcode = STALLED;
 			return;
 		}
-		if(IF_ID.opcode == "done"){
+		if(IF_ID.inst.opcode == DONE){
 			valid_id = true;
-			ID_EX.opcode = "done";
+			ID_EX.inst.opcode = DONE;
 			return;
 		}
-		if(IF_ID.opcode == "j"){
+		trace.stage(IF_ID.id, 1, "D");
+		Instruction &inst = IF_ID.inst;
+		Kind kind = IF_ID.kind;
+		if(kind == KIND_JUMP || kind == KIND_LINK){
 			if(valid_if){
 				valid_id = true;
 			}
 		}
-		if(stall){
+		if constexpr (Hazard::forwarding){
+			stall = false;
+		}
+		else if(stall){
 			return;
 		}
-		string opcode = IF_ID.opcode;
-		string r1 = IF_ID.reg1;
-		string r2 = IF_ID.reg2;
-		string r3 = IF_ID.reg3;
-		exitcode = 0;
-		if(opcode == "add" || opcode == "sub" || opcode == "mul" || opcode == "slt"){
-			if (!checkRegisters({r1, r2, r3}) || registerMap[r1] == 0) {
-				exitcode = 1;
+		int pc = PCcurr;
+		// a streamed instruction is checked, and its label resolved, the first time it is decoded
+		if(!commands.command(pc).checked){
+			ProgramError error = decode(pc);
+			if(error.code != Program::SUCCESS){
+				fault = error;
 				return;
 			}
-			if(occupied.find(r2) != occupied.end() || occupied.find(r3) != occupied.end()){
-				stall = true;
-				ID_EX.opcode = "stalled";
-				return;
-			}
-			ID_EX.r2_val = registers[registerMap[r2]];
-			ID_EX.r3_val = registers[registerMap[r3]];
-			occupied[r1]++;
-			PCcurr++;
+			inst.target = commands.command(pc).inst.target;
 		}
-		else if(opcode == "bne" || opcode == "beq"){
-			if (!checkLabel(r3)){
-				exitcode = 4;
-				return;
-			}
-			if (address.find(r3) == address.end() || address[r3] == -1){
-				exitcode = 2;
-				return;
+		if(kind == KIND_REGISTER){
+			if constexpr (Hazard::forwarding){
+				if(!forward(inst.rs, ID_EX.rs_val) || !forward(inst.rt, ID_EX.rt_val)){
+					stallDecode();
+					return;
+				}
 			}
-			if (!checkRegisters({r1, r2})){
-				exitcode = 1;
-				return;
+			else{
+				if(occupied[inst.rs] || occupied[inst.rt]){
+					stallDecode(occupied[inst.rs] ? inst.rs : inst.rt);
+					return;
+				}
+				ID_EX.rs_val = registers[inst.rs];
+				ID_EX.rt_val = registers[inst.rt];
+				occupyDestination(inst.rd);
+				if(inst.opcode == OP_DIV){
+					occupy(REG_HI);
+				}
 			}
-			if(occupied.find(r1) != occupied.end() || occupied.find(r2) != occupied.end()){
-				stall = true;
-				ID_EX.opcode = "stalled";
-				return;
+			PCcurr++;
+		}
+		else if(kind == KIND_BRANCH){
+			if constexpr (Hazard::forwarding){
+				bool ready1 = forward(inst.rs, ID_EX.rs_val);
+				bool ready2 = forward(inst.rt, ID_EX.rt_val);
+				if(!ready1 || !ready2){
+					if constexpr (!Hazard::predict){
+						stallDecode();
+						return;
+					}
+					speculate(pc, inst.target, !ready1, !ready2);
+				}
 			}
-			ID_EX.r1_val = registers[registerMap[r1]];
-			ID_EX.r2_val = registers[registerMap[r2]];
-			if(opcode == "beq"){
-				if(ID_EX.r1_val == ID_EX.r2_val){
-					PCcurr = address[r3];
-				}else{
-					PCcurr++;
+			else{
+				if(occupied[inst.rs] || occupied[inst.rt]){
+					stallDecode(occupied[inst.rs] ? inst.rs : inst.rt);
+					return;
 				}
+				ID_EX.rs_val = registers[inst.rs];
+				ID_EX.rt_val = registers[inst.rt];
 			}
-			else if(opcode == "bne"){
-				if(ID_EX.r1_val != ID_EX.r2_val){
-					PCcurr = address[r3];
-				}else{
-					PCcurr++;
+			if(!speculating){
+				bool taken = branchTaken(inst, ID_EX.rs_val, ID_EX.rt_val);
+				if constexpr (Hazard::predict){
+					predictor->update(pc, taken);
 				}
+				PCcurr = taken ? inst.target : PCcurr + 1;
 			}
 		}
-		else if(opcode == "addi"){
-			if (!checkRegisters({r1, r2}) || registerMap[r1] == 0){
-				exitcode = 1;
-				return;
+		else if(kind == KIND_JUMP_REGISTER){
+			if constexpr (Hazard::forwarding){
+				if(!forward(inst.rs, ID_EX.rs_val)){
+					stallDecode();
+					return;
+				}
+			}
+			else{
+				if(occupied[inst.rs]){
+					stallDecode(inst.rs);
+					return;
+				}
+				ID_EX.rs_val = registers[inst.rs];
 			}
-			if(occupied.find(r2) != occupied.end()){
-				stall = true;
-				ID_EX.opcode = "stalled";
+			int target = jumpTarget(ID_EX.rs_val);
+			if(target < 0){
+				trap(pc, 1, Program::INVALID_ADDRESS, "jump target " + to_string(ID_EX.rs_val) + " is not an instruction");
 				return;
 			}
-			ID_EX.r1_val = registers[registerMap[r1]];
-			ID_EX.r2_val = registers[registerMap[r2]];
-			ID_EX.r3_val = stoi(r3);
-			occupied[r1]++;
-			PCcurr++;
+			PCcurr = target;
 		}
-		else if(opcode == "j"){
-			if (!checkLabel(r1)){
-				exitcode = 4;
-				return;
+		else if(kind == KIND_IMMEDIATE){
+			if constexpr (Hazard::forwarding){
+				if(!forward(inst.rs, ID_EX.rs_val)){
+					stallDecode();
+					return;
+				}
 			}
-			if (address.find(r1) == address.end() || address[r1] == -1){
-				exitcode = 2;	
-				return;
+			else{
+				if(occupied[inst.rs]){
+					stallDecode(inst.rs);
+					return;
+				}
+				ID_EX.rs_val = registers[inst.rs];
+				occupyDestination(inst.rd);
 			}
-			PCcurr = address[r1];
+			PCcurr++;
 		}
-		else if(opcode == "lw"){
-			int lparen = r2.find('('), offset = stoi(lparen == 0 ? "0" : r2.substr(0, lparen));
-			string reg = r2.substr(lparen + 1);
-			reg.pop_back();
-			if (!checkRegister(r1) || registerMap[r1] == 0){
-				exitcode = 1;
-				return;
+		else if(kind == KIND_JUMP || kind == KIND_LINK){
+			if(kind == KIND_LINK){
+				if constexpr (!Hazard::forwarding){
+					occupy(inst.rd);
+				}
 			}
-			if(occupied.find(r1) != occupied.end() || occupied.find(reg) != occupied.end()){
-				stall = true;
-				ID_EX.opcode = "stalled";
-				return;
+			PCcurr = inst.target;
+		}
+		else if(kind == KIND_LOAD){
+			// with forwarding every write ahead of a load or store has reached the registers by the time it reads them in MEM
+			if constexpr (!Hazard::forwarding){
+				if(occupied[inst.rd] || occupied[inst.rs]){
+					stallDecode(occupied[inst.rd] ? inst.rd : inst.rs);
+					return;
+				}
+				occupyDestination(inst.rd);
 			}
-			ID_EX.r1_val = registers[registerMap[r1]];
-			ID_EX.r2_val = registers[registerMap[reg]];
-			occupied[r1]++;
 			PCcurr++;
 		}
-		else if(opcode == "sw"){
-			int lparen = r2.find('('), offset = stoi(lparen == 0 ? "0" : r2.substr(0, lparen));
-			string reg = r2.substr(lparen + 1);
-			reg.pop_back();
-			if (!checkRegister(r1)){
-				exitcode = 1;	
-				return;
-			}
-			if(occupied.find(r1) != occupied.end() || occupied.find(reg) != occupied.end()){
-				stall = true;
-				ID_EX.opcode = "stalled";
-				return;
+		else if(kind == KIND_STORE){
+			if constexpr (!Hazard::forwarding){
+				if(occupied[inst.rt] || occupied[inst.rs]){
+					stallDecode(occupied[inst.rt] ? inst.rt : inst.rs);
+					return;
+				}
+				occupy(inst.rs);
 			}
-			ID_EX.r1_val = registers[registerMap[r1]];
-			ID_EX.r2_val = registers[registerMap[reg]];
-			occupied[reg]++;
 			PCcurr++;
 		}
-		ID_EX.reg1 = IF_ID.reg1;
-		ID_EX.reg2 = IF_ID.reg2;
-		ID_EX.reg3 = IF_ID.reg3;
-		ID_EX.opcode = IF_ID.opcode;
+		ID_EX.inst = inst;
+		ID_EX.kind = kind;
+		ID_EX.id = IF_ID.id;
+		ID_EX.pc = pc;
+		countIssued(kind, pc);
 		// printRegistersAndData(1);
 	}
 
+	// whether the instruction in a later stage writes register reg, a bubble writes nothing
+	template <class Latch>
+	static bool produces(const Latch &latch, int reg)
+	{
+		if (!inFlight(latch.inst.opcode))
+			return false;
+		if (latch.inst.opcode == OP_DIV)
+			return reg == REG_LO || reg == REG_HI;
+		return writesRegister(latch.kind) && latch.inst.rd == reg;
+	}
+
+	// whether the latch holds a load of register reg
+	template <class Latch>
+	static bool loads(const Latch &latch, int reg)
+	{
+		return inFlight(latch.inst.opcode) && latch.kind == KIND_LOAD && latch.inst.rd == reg;
+	}
+
+	// value of register reg for the instruction in decode, taken from the nearest instruction ahead of it that writes reg.
+	// false if that instruction is a load still in EX, whose value only exists after MEM
+	bool forward(int reg, int &value)
+	{
+		if (reg != 0 && produces(EX_MEM, reg))
+		{
+			if (EX_MEM.kind == KIND_LOAD)
+			{
+				hazard = reg;
+				return false;
+			}
+			value = reg == REG_HI ? EX_MEM.data : EX_MEM.result;
+			return true;
+		}
+		if (reg != 0 && produces(MEM_WB, reg))
+		{
+			value = MEM_WB.kind == KIND_LOAD || reg == REG_HI ? MEM_WB.data : MEM_WB.result;
+			return true;
+		}
+		value = registers[reg];
+		return true;
+	}
+
+	// keep the instruction in decode and send a bubble down the pipeline, the stall policy names the
+	// register it waits for
+	void stallDecode(int reg = -1)
+	{
+		if (reg >= 0)
+			hazard = reg;
+		stall = true;
+		ID_EX.inst.opcode = STALLED;
+	}
+
+	// a write to reg is in flight. a store holds its base register, $zero included, until MEM
+	void occupy(int reg)
+	{
+		if (occupied[reg]++ == 0)
+			++occupiedCount;
+	}
+
+	// the write to reg has landed, any others in flight to it are done as well
+	void vacate(int reg)
+	{
+		if (occupied[reg] != 0)
+		{
+			occupied[reg] = 0;
+			--occupiedCount;
+		}
+	}
+
+	// nothing waits for a write to $zero, which is dropped
+	void occupyDestination(int reg)
+	{
+		if (reg != 0)
+			occupy(reg);
+	}
+
+	void vacateDestination(int reg)
+	{
+		if (reg != 0)
+			vacate(reg);
+	}
+
+	// decode a branch whose operand is still being loaded along the predicted direction
+	void speculate(int pc, int target, bool first, bool second)
+	{
+		speculating = true;
+		speculativePC = pc;
+		speculativeTarget = target;
+		waiting1 = first;
+		waiting2 = second;
+		predictedTaken = predictor->predict(pc);
+		PCcurr = predictedTaken ? target : pc + 1;
+	}
+
+	// the load the branch waited for has just left MEM, squash the fetched instruction if the prediction was wrong
+	void resolveBranch()
+	{
+		if (waiting1)
+			ID_EX.rs_val = MEM_WB.data;
+		if (waiting2)
+			ID_EX.rt_val = MEM_WB.data;
+		bool taken = branchTaken(ID_EX.inst, ID_EX.rs_val, ID_EX.rt_val);
+		predictor->update(speculativePC, taken);
+		perf.branchesTaken += taken;
+		if (profiling)
+			profile.counts[speculativePC].taken += taken;
+		if (taken != predictedTaken)
+		{
+			++perf.branchMispredictions;
+			if (profiling)
+				++profile.counts[speculativePC].mispredicted;
+			PCcurr = taken ? speculativeTarget : speculativePC + 1;
+			if (inFlight(IF_ID.inst.opcode))
+				trace.squash(IF_ID.id);
+			IF_ID.inst.opcode = EMPTY;
+		}
+		speculating = false;
+	}
+
+	// a stage may finish before the end marker reaches it only if what follows it has nothing left
+	// to do: bubbles, the marker itself, or jumps and branches already resolved in decode
+	bool drained(Opcode opcode)
+	{
+		return !inFlight(opcode) || opcode == OP_J || opcode == OP_JR || ((opcode == OP_BEQ || opcode == OP_BNE) && !speculating);
+	}
+
 	void EX_Stage() {
-		if(ID_EX.opcode == ""){
+		HOST_TIMER(EX);
+		if(ID_EX.inst.opcode == EMPTY){
 			return;
 		}
-		if(ID_EX.opcode == "done"){
+		if(ID_EX.inst.opcode == DONE){
 			valid_ex = true;
-			EX_MEM.opcode = "done";
+			EX_MEM.inst.opcode = DONE;
 			return;
 		}
-		if(ID_EX.opcode == "stalled"){
-			EX_MEM.opcode = "stalled";
+		if(ID_EX.inst.opcode == STALLED){
+			EX_MEM.inst.opcode = STALLED;
 			return;
 		}
-		if(ID_EX.opcode == "beq" || ID_EX.opcode == "bne"){
-			if(valid_if){
+		perf.busy[PerfCounters::EX] = true;
+		trace.stage(ID_EX.id, 2, "X");
+		Kind kind = ID_EX.kind;
+		if(kind == KIND_BRANCH || kind == KIND_JUMP_REGISTER){
+			if(valid_if && drained(IF_ID.inst.opcode)){
 				valid_ex = true;
 			}
 		}
 		// Execute instruction
-		string opcode = ID_EX.opcode;
-		string r1 = ID_EX.reg1;
-		string r2 = ID_EX.reg2;
-		string r3 = ID_EX.reg3;
-		int r1_val = ID_EX.r1_val;
-		int r2_val = ID_EX.r2_val;
-		int r3_val = ID_EX.r3_val;
-		EX_MEM.opcode = ID_EX.opcode;
-		EX_MEM.reg1 = ID_EX.reg1;
-		EX_MEM.reg2 = ID_EX.reg2;
-		int result;
-
-		if(opcode == "add"){
-			result = r2_val + r3_val;
-			// PCnext = PCcurr + 1;
-		}
-		else if(opcode == "sub"){
-			result = r2_val - r3_val;
-			// PCnext = PCcurr + 1;
-		}
-		else if(opcode == "mul"){
-			result = r2_val*r3_val;
-			// PCnext = PCcurr + 1;
-		}
-		else if(opcode == "addi"){
-			result = r2_val + r3_val;
-			// PCnext = PCcurr + 1;
-		}
-		else if(opcode == "beq"){
-			result = r1_val == r2_val ? 1 : 0;
-			// if(result == 1){
-			// 	PCcurr = address[r3];
-			// }else{
-			// 	PCnext++;
-			// }
-		}
-		else if(opcode == "bne"){
-			result = r1_val != r2_val ? 1 : 0;
-			// if(result == 1){
-			// 	PCcurr = address[r3];
-			// }else{
-			// 	PCnext++;
-			// }
-		}
-		else if(opcode == "slt"){
-			result = r2_val < r3_val ? 1 : 0;
-			// PCnext = PCcurr + 1;
-		}
-		// else if(opcode == "j"){
-		// 	PCnext = address[r1];
-		// }
-		// else if(opcode == "lw" || opcode == "sw"){
-		// 	PCnext = PCcurr + 1;
-		// }
+		EX_MEM.inst = ID_EX.inst;
+		EX_MEM.kind = kind;
+		EX_MEM.id = ID_EX.id;
+		EX_MEM.pc = ID_EX.pc;
+		if constexpr (Hazard::predict){
+			if(speculating){
+				resolveBranch();
+			}
+		}
+		int result = 0;
+		if(kind == KIND_BRANCH){
+			result = branchTaken(ID_EX.inst, ID_EX.rs_val, ID_EX.rt_val) ? 1 : 0;
+		}
+		else if(writesResult(kind)){
+			result = aluResult(ID_EX.inst, ID_EX.rs_val, ID_EX.rt_val);
+			// div leaves its remainder in data
+			if(ID_EX.inst.opcode == OP_DIV){
+				EX_MEM.data = aluResult2(ID_EX.inst, ID_EX.rs_val, ID_EX.rt_val);
+			}
+		}
 		EX_MEM.result = result;
 		// printRegistersAndData(2);
 	}
 
 	void MEM_Stage() {
-		if(EX_MEM.opcode == ""){
+		HOST_TIMER(MEM);
+		if(EX_MEM.inst.opcode == EMPTY){
 			return;
 		}
-		if(EX_MEM.opcode == "done"){
+		if(EX_MEM.inst.opcode == DONE){
 			valid_mem = true;
-			MEM_WB.opcode = "done";
+			MEM_WB.inst.opcode = DONE;
 			return;
 		}
-		if(EX_MEM.opcode == "stalled"){
-			MEM_WB.opcode = "stalled";
+		if(EX_MEM.inst.opcode == STALLED){
+			MEM_WB.inst.opcode = STALLED;
 			return;
 		}
+		perf.busy[PerfCounters::MEM] = true;
+		trace.stage(EX_MEM.id, 3, "M");
+		const Instruction &inst = EX_MEM.inst;
+		Kind kind = EX_MEM.kind;
 		
-		if(EX_MEM.opcode == "sw"){
-			if(valid_if){
+		if(kind == KIND_STORE){
+			if(valid_if && drained(ID_EX.inst.opcode) && drained(IF_ID.inst.opcode)){
 				valid_mem = true;
 			}
 		}
 		
 		
 		// Access memory
-		MEM_WB.reg1 = EX_MEM.reg1;
+		MEM_WB.inst = inst;
+		MEM_WB.kind = kind;
 		MEM_WB.result = EX_MEM.result;
-		MEM_WB.opcode = EX_MEM.opcode;
+		MEM_WB.data = EX_MEM.data;
+		MEM_WB.id = EX_MEM.id;
+		MEM_WB.pc = EX_MEM.pc;
 		
-		if(MEM_WB.opcode == "lw"){
-			int address = locateAddress(EX_MEM.reg2);
-			MEM_WB.data = data[address];
-		}
-		else if(MEM_WB.opcode == "sw"){
-			int address = locateAddress(EX_MEM.reg2);
-			if (data[address] != registers[registerMap[EX_MEM.reg1]])
-				memoryDelta[address] = registers[registerMap[EX_MEM.reg1]];
-			data[address] = registers[registerMap[EX_MEM.reg1]];
-			int lparen = EX_MEM.reg2.find('('), offset = stoi(lparen == 0 ? "0" : EX_MEM.reg2.substr(0, lparen));
-			string reg = EX_MEM.reg2.substr(lparen + 1);
-			reg.pop_back();
-			occupied.erase(reg);
-			stall = false;
-			// PCnext = PCcurr + 1;	
+		if(kind == KIND_LOAD){
+			int address = effectiveAddress(inst.rs, inst.imm, inst.accessSize());
+			if(address < 0){
+				badAccess(inst.accessSize());
+			}
+			else{
+				MEM_WB.data = load(inst, address);
+			}
+		}
+		else if(kind == KIND_STORE){
+			int address = effectiveAddress(inst.rs, inst.imm, inst.accessSize());
+			if(address < 0){
+				badAccess(inst.accessSize());
+			}
+			else{
+				store(inst, address, registers[inst.rt]);
+			}
+			if constexpr (!Hazard::forwarding){
+				vacate(inst.rs);
+				stall = false;
+			}
 		}	
 		// printRegistersAndData(3);
 	}
 
+	// a store rewrote instruction pc in unified memory. it is decoded again on its next fetch, and
+	// fetched again if it is already in the pipeline behind the store
+	void invalidate(int pc)
+	{
+		commands.command(pc).stale = true;
+		if (inFlight(ID_EX.inst.opcode) && ID_EX.pc == pc)
+		{
+			if constexpr (!Hazard::forwarding){
+				unmark(ID_EX.inst, ID_EX.kind);
+			}
+			trace.squash(ID_EX.id);
+			ID_EX.inst.opcode = STALLED;
+			// the branch ahead of the squashed fetch is the one being refetched
+			speculating = false;
+		}
+		else if (!inFlight(IF_ID.inst.opcode) || PCcurr != pc)
+			return;
+		if (inFlight(IF_ID.inst.opcode))
+			trace.squash(IF_ID.id);
+		IF_ID.inst.opcode = EMPTY;
+		PCcurr = pc;
+		stall = false;
+		valid_if = valid_id = false;
+	}
+
+	static bool inFlight(Opcode opcode)
+	{
+		return opcode <= INVALID;
+	}
+
+	// forget the pending writes of a decoded instruction that is squashed, stall policy only
+	void unmark(const Instruction &squashed, Kind kind)
+	{
+		auto release = [this](int reg)
+		{
+			if (occupied[reg] > 0 && --occupied[reg] == 0)
+				--occupiedCount;
+		};
+		if (kind == KIND_STORE)
+			release(squashed.rs);
+		else if (writesRegister(kind) && squashed.rd != 0)
+			release(squashed.rd);
+		if (squashed.opcode == OP_DIV)
+			release(REG_HI);
+	}
+
+	// decode instruction pc again from the word in memory, a word that is not an instruction
+	// faults when it reaches decode. the assembler rejects writes to $zero but encoded words may make
+	// them, the zero word is sll $zero, $zero, 0, and they run with the write dropped
+	void reload(int pc)
+	{
+		CommandStream::Command &command = commands.command(pc);
+		command = CommandStream::Command();
+		command.line = 0;
+		if (!mips32::decode(uint32_t(data[pc]), pc, base, commands.size(), command.inst))
+		{
+			command.inst = Instruction{INVALID};
+			command.text = ".word " + to_string(data[pc]);
+			command.error = {Program::SYNTAX_ERROR, 0, "the word " + to_string(data[pc]) + " at byte " + to_string(base + 4 * pc) + " is not an instruction"};
+			return;
+		}
+		command.kind = kindOf(command.inst);
+		command.text = textOf(command.inst);
+	}
+
+	// the source form of a decoded instruction, branch and jump targets are byte addresses
+	string textOf(const Instruction &inst)
+	{
+		auto reg = [](int r)
+		{ return string(Program::registerName(r)); };
+		string name = opcodeName(inst.opcode) + " ";
+		if (inst.isBranch())
+			return name + reg(inst.rs) + ", " + reg(inst.rt) + ", " + to_string(base + 4 * inst.target);
+		if (inst.opcode == OP_J || inst.opcode == OP_JAL)
+			return name + to_string(base + 4 * inst.target);
+		if (inst.opcode == OP_JR)
+			return name + reg(inst.rs);
+		if (inst.opcode == OP_DIV)
+			return name + reg(inst.rs) + ", " + reg(inst.rt);
+		if (inst.opcode == OP_MFHI || inst.opcode == OP_MFLO)
+			return name + reg(inst.rd);
+		if (inst.opcode == OP_LUI)
+			return name + reg(inst.rd) + ", " + to_string(inst.imm);
+		if (inst.isMemory())
+			return name + reg(inst.isLoad() ? inst.rd : inst.rt) + ", " + to_string(inst.imm) + "(" + reg(inst.rs) + ")";
+		if (kindOf(inst) == KIND_IMMEDIATE)
+			return name + reg(inst.rd) + ", " + reg(inst.rs) + ", " + to_string(inst.imm);
+		return name + reg(inst.rd) + ", " + reg(inst.rs) + ", " + reg(inst.rt);
+	}
+
+	// switch to unified memory: the program is encoded into the words below its data
+	void loadCode()
+	{
+		unified = true;
+		devices.dataStart = 0;
+		if (loadError.code != Program::SUCCESS)
+			return;
+		for (int pc = 0; pc < min(commands.size(), memoryBytes >> 2); ++pc)
+		{
+			uint32_t word;
+			if (!mips32::encode(commands.command(pc).inst, pc, base, word))
+			{
+				loadError = problem(pc, 0, Program::SYNTAX_ERROR, "'" + commandText(pc) + "' has no 32-bit encoding for unified memory");
+				return;
+			}
+			stateHash.update(pc, data[pc], int(word));
+			data[pc] = int(word);
+		}
+	}
+
+	void badAccess(int size)
+	{
+		int address = registers[EX_MEM.inst.rs] + EX_MEM.inst.imm;
+		trap(EX_MEM.pc, 2, Program::INVALID_ADDRESS, "address " + to_string(address) + (address % size ? " is not aligned to " + to_string(size) + " bytes" : " is outside data memory"));
+	}
+
 	void WB_Stage() {
-		if(MEM_WB.opcode == ""){
+		HOST_TIMER(WB);
+		if(MEM_WB.inst.opcode == EMPTY){
 			return;
 		}
-		if(MEM_WB.opcode == "done"){
+		if(MEM_WB.inst.opcode == DONE){
 			valid_wb = true;
 			return;
 		}
-		if(MEM_WB.opcode == "stalled"){
+		if(MEM_WB.inst.opcode == STALLED){
 			return;
 		}
-		if(MEM_WB.opcode == "lw" || MEM_WB.opcode == "add" || MEM_WB.opcode == "sub" || MEM_WB.opcode == "mul" || MEM_WB.opcode == "slt" || MEM_WB.opcode == "addi"){
-			if(valid_if){
+		perf.busy[PerfCounters::WB] = true;
+		trace.stage(MEM_WB.id, 4, "W");
+		trace.retire(MEM_WB.id);
+		const Instruction &inst = MEM_WB.inst;
+		Kind kind = MEM_WB.kind;
+		if(writesRegister(kind)){
+			if(valid_if && drained(EX_MEM.inst.opcode) && drained(ID_EX.inst.opcode) && drained(IF_ID.inst.opcode)){
 				valid_wb = true;
 			}
 		}
 		// Write back result to register file		
 
-		if(MEM_WB.opcode == "lw"){
-			registers[registerMap[MEM_WB.reg1]] = MEM_WB.data;
-			// PCnext = PCcurr + 1;
-			occupied.erase(MEM_WB.reg1);
-			if(occupied.empty()){
-				stall = false;
+		if(kind == KIND_LOAD){
+			writeRegister(inst.rd, MEM_WB.data);
+			if constexpr (!Hazard::forwarding){
+				vacateDestination(inst.rd);
+				if(occupiedCount == 0){
+					stall = false;
+				}
 			}
 		}
-		else if(MEM_WB.opcode == "add" || MEM_WB.opcode == "sub" || MEM_WB.opcode == "mul" || MEM_WB.opcode == "slt" || MEM_WB.opcode == "addi"){
-			registers[registerMap[MEM_WB.reg1]] = MEM_WB.result;
-			occupied.erase(MEM_WB.reg1);
-			if(occupied.empty()){	
-				stall = false;
+		else if(writesResult(kind)){
+			writeRegister(inst.rd, MEM_WB.result);
+			if(inst.opcode == OP_DIV){
+				writeRegister(REG_HI, MEM_WB.data);
 			}
+			if constexpr (!Hazard::forwarding){
+				vacateDestination(inst.rd);
+				if(inst.opcode == OP_DIV){
+					vacate(REG_HI);
+				}
+				if(occupiedCount == 0){	
+					stall = false;
+				}
+			}
+		}
+		++retirements;
+		perf.retire(inst.opcode);
+		if(golden){
+			checkRetirement();
 		}
+		watchLoop();
 		// printRegistersAndData(4);
 	}
 
 	void executeCommandsPipelined()
 	{
-		if (commands.size() >= MAX / 4)
+		started = chrono::steady_clock::now();
+		if (commands.complete() && commands.size() >= memoryBytes / 4)
 		{
-			handleExit(MEMORY_ERROR, 0);
+			ProgramError error;
+			error.code = Program::MEMORY_ERROR;
+			error.reason = to_string(commands.size()) + " instructions do not fit in memory";
+			handleExit(error);
+			return;
+		}
+		// the first problem in a loaded program is reported before it runs
+		if (loadError.code != Program::SUCCESS)
+		{
+			handleExit(loadError);
 			return;
 		}
 
@@ -760,7 +1109,11 @@ struct MIPS_Architecture
 		while (!(valid_if && valid_id && valid_ex && valid_mem && valid_wb))
 		{
 			++clockCycles;
-			exitcode = 0;
+			trace.cycle();
+			devices.cycles = clockCycles;
+			// a streamed program grows as it runs, data may only follow what has been read
+			devices.dataStart = dataStart();
+			devices.instructions = perf.retired;
 			// cout << clockCycles << "\n";
 			WB_Stage();
 			// cout << "WB_Stage done" << "\n";
@@ -775,9 +1128,223 @@ struct MIPS_Architecture
 			}
 			// cout << "IF_Stage done" << "\n";
 			// PCcurr = PCnext;
-			printRegistersAndMemoryDelta(clockCycles);
+			runDma();
+			if(output == OUTPUT_CYCLES){
+				printRegistersAndMemoryDelta(clockCycles);
+			}
+			else{
+				memoryDelta.clear();
+			}
+			countCycle();
+			checkLimits();
+			if(!result.finished() || fault.code != Program::SUCCESS){
+				break;
+			}
+		}
+		handleExit(fault);
+		if(output == OUTPUT_FINAL){
+			printFinalState();
+		}
+		if(result.status > RunResult::PROGRAM_ERROR){
+			cerr << "Stopped in cycle " << clockCycles << " after " << retirements << " instructions: " << result.reason << '\n';
 		}
-		handleExit(SUCCESS, clockCycles);
+		if(golden && result.finished()){
+			if(golden->PCcurr < (int)golden->commands.size()){
+				reportDivergence("the pipeline finished before the functional model");
+			}
+			else{
+				cerr << "Co-simulation passed: " << retirements << " instructions matched the functional model\n";
+			}
+		}
+		result.cycles = clockCycles;
+		result.instructions = retirements;
+		result.seconds = elapsed();
+		trace.close();
+		HOST_REPORT(cerr, clockCycles);
+		if(!statsPath.empty() && !perf.write(statsPath)){
+			cerr << "Could not write statistics to " << statsPath << '\n';
+		}
+		if(profiling && !profile.write(profilePath, listing(), lineNumbers(), address, clockCycles)){
+			cerr << "Could not write the profile to " << profilePath << '\n';
+		}
+	}
+
+	// run the instruction leaving WB on the functional model and compare the architectural state.
+	// every register write happens in WB and every store in MEM, so the pipeline's state is exactly
+	// that of the instructions retired so far. equal states have equal running hashes, and a state that
+	// differs is missed only if its hash happens to collide
+	void checkRetirement()
+	{
+		int pc = golden->PCcurr;
+		if (pc < golden->commands.size() && golden->commands.command(pc).stale)
+		{
+			golden->reload(pc);
+			golden->decode(pc);
+		}
+		if (pc >= (int)golden->commands.size() || golden->commands.command(pc).inst.opcode != MEM_WB.inst.opcode)
+		{
+			reportDivergence("the pipeline retired " + opcodeName(MEM_WB.inst.opcode) + " but the functional model " + (pc >= (int)golden->commands.size() ? string("has finished") : "executes " + golden->commandText(pc)));
+			return;
+		}
+		int status = golden->execute(golden->commands.command(pc).inst);
+		if (status != 0)
+		{
+			reportDivergence("the functional model stopped with exit code " + to_string(status) + " at " + golden->commandText(pc));
+			return;
+		}
+		golden->PCcurr = golden->PCnext;
+		golden->memoryDelta.clear();
+		if (stateHash != golden->stateHash)
+			reportDivergence("state differs after " + golden->commandText(pc) + " (pc " + to_string(pc) + ")");
+	}
+
+	// stop the run and list what the pipeline and the functional model disagree on
+	void reportDivergence(const string &reason)
+	{
+		diverged = true;
+		stop(RunResult::CHECK_MISMATCH, reason);
+		cerr << "Co-simulation mismatch at retirement " << retirements << ", cycle " << clockCycles << ": " << reason << '\n';
+		for (int i = 0; i < NUM_REGISTERS; ++i)
+			if (registers[i] != golden->registers[i])
+				cerr << "  register " << i << ": pipeline " << registers[i] << ", functional " << golden->registers[i] << '\n';
+		for (int i = 0; i < (memoryBytes >> 2); ++i)
+			if (data[i] != golden->data[i])
+				cerr << "  memory word " << i << ": pipeline " << data[i] << ", functional " << golden->data[i] << '\n';
+	}
+
+	// end the run after this cycle, the first reason given is the one reported
+	void stop(RunResult::Status status, const string &reason)
+	{
+		if (!result.finished())
+			return;
+		result.status = status;
+		result.reason = reason;
+		result.pc = MEM_WB.pc;
+	}
+
+	double elapsed() const
+	{
+		return chrono::duration<double>(chrono::steady_clock::now() - started).count();
+	}
+
+	// the budgets are checked every cycle except wall time, which is read every 1024 cycles
+	void checkLimits()
+	{
+		if (valid_if && valid_id && valid_ex && valid_mem && valid_wb)
+			return;
+		if (limits.maxCycles > 0 && clockCycles >= limits.maxCycles)
+			stop(RunResult::CYCLE_LIMIT, "cycle limit of " + to_string(limits.maxCycles) + " reached");
+		else if (limits.maxInstructions > 0 && retirements >= limits.maxInstructions)
+			stop(RunResult::INSTRUCTION_LIMIT, "instruction limit of " + to_string(limits.maxInstructions) + " reached");
+		else if (limits.maxSeconds > 0 && (clockCycles & 1023) == 0 && elapsed() >= limits.maxSeconds)
+		{
+			string seconds = to_string(limits.maxSeconds);
+			seconds.erase(seconds.find_last_not_of('0') + 1);
+			if (seconds.back() == '.')
+				seconds.pop_back();
+			stop(RunResult::TIME_LIMIT, "time limit of " + seconds + " seconds reached");
+		}
+	}
+
+	// feed the state after the instruction leaving WB to the watchdog. a DMA copy changes memory
+	// outside the program's control, so the watchdog only watches while none is running
+	void watchLoop()
+	{
+		if (!limits.watchdog)
+			return;
+		if (devices.status == Devices::BUSY)
+			watchdog.reset();
+		else if (watchdog.repeats(MEM_WB.pc, stateHash.value))
+		{
+			string text = commands.has(MEM_WB.pc) ? commandText(MEM_WB.pc) + " " : "";
+			stop(RunResult::LOOP, "the state after " + text + "(pc " + to_string(MEM_WB.pc) + ") repeats, the program never finishes");
+		}
+	}
+
+	// the DMA engine copies alongside the pipeline, its writes show in the cycle's memory delta.
+	// under --check they go to the functional model as well, which has no devices of its own
+	void runDma()
+	{
+		devices.tick([this](int from, int to)
+					 {
+			storeWord(to, data[from]);
+			if (golden)
+				golden->storeWord(to, data[from]); });
+	}
+
+	// charge the instruction leaving decode to the counters
+	void countIssued(Kind kind, int pc)
+	{
+		perf.busy[PerfCounters::ID] = true;
+		++perf.issued;
+		if (profiling)
+			++profile.counts[pc].executed;
+		if (kind == KIND_BRANCH)
+		{
+			++perf.branches;
+			if (!speculating)
+			{
+				perf.branchesTaken += PCcurr != pc + 1;
+				if (profiling)
+					profile.counts[pc].taken += PCcurr != pc + 1;
+			}
+		}
+		else if (kind == KIND_JUMP || kind == KIND_LINK || kind == KIND_JUMP_REGISTER)
+			++perf.jumps;
+		else if (kind == KIND_LOAD)
+			++perf.memoryReads;
+		else if (kind == KIND_STORE)
+			++perf.memoryWrites;
+	}
+
+	// a cycle in which decode holds back its instruction is charged to what it waits for
+	void countCycle()
+	{
+		if (stall && !perf.busy[PerfCounters::ID])
+		{
+			PerfCounters::StallCause cause = stallCause();
+			perf.stall(cause, hazard);
+			if (trace.enabled && tracedStall != IF_ID.id)
+			{
+				trace.note(IF_ID.id, string("stalled on ") + Program::registerName(hazard) + " (" + PerfCounters::causeNames[cause] + ")");
+				tracedStall = IF_ID.id;
+			}
+			// decode has not moved past the instruction it holds
+			if (profiling)
+				++profile.counts[PCcurr].stallCycles;
+		}
+		perf.endCycle();
+	}
+
+	// a command as written, for the profile and the trace
+	const string &commandText(int pc)
+	{
+		return commands.command(pc).text;
+	}
+
+	vector<int> lineNumbers()
+	{
+		vector<int> lines;
+		for (int pc = 0; pc < (int)commands.size(); ++pc)
+			lines.push_back(commands.lineOf(pc));
+		return lines;
+	}
+
+	vector<string> listing()
+	{
+		vector<string> text;
+		for (int pc = 0; pc < (int)commands.size(); ++pc)
+			text.push_back(commandText(pc));
+		return text;
+	}
+
+	PerfCounters::StallCause stallCause()
+	{
+		if (inFlight(IF_ID.inst.opcode) && (IF_ID.kind == KIND_BRANCH || IF_ID.kind == KIND_JUMP_REGISTER))
+			return PerfCounters::BRANCH;
+		if (loads(ID_EX, hazard) || loads(EX_MEM, hazard) || loads(MEM_WB, hazard))
+			return PerfCounters::LOAD_USE;
+		return PerfCounters::RAW;
 	}
 
 	void printRegistersAndData(int stage)
@@ -785,39 +1352,38 @@ struct MIPS_Architecture
         if (stage==1)
         {
             cout << "\tID STAGE" << endl;
-            cout << "\t\topcode: " << IF_ID.opcode << endl;
-            cout << "\t\tr1: " << IF_ID.reg1 << endl;
-            cout << "\t\tr2: " << IF_ID.reg2 << endl;
-            cout << "\t\tr3: " << IF_ID.reg3 << endl;
+            cout << "\t\topcode: " << IF_ID.inst.opcode << endl;
+            cout << "\t\trd: " << IF_ID.inst.rd << endl;
+            cout << "\t\trs: " << IF_ID.inst.rs << endl;
+            cout << "\t\trt: " << IF_ID.inst.rt << endl;
             cout << endl;
 
-            cout << "\t\tr1_value: " << registers[registerMap[IF_ID.reg1]]<< endl;
-            cout << "\t\tr2_value: " << registers[registerMap[IF_ID.reg2]] << endl;
-            cout << "\t\tr3_value: " << registers[registerMap[IF_ID.reg3]] << endl;
+            cout << "\t\trs_value: " << registers[IF_ID.inst.rs] << endl;
+            cout << "\t\trt_value: " << registers[IF_ID.inst.rt] << endl;
         }   
         else if (stage==2)
         {
             cout << "\tEX STAGE" << endl;
-            cout << "\t\topcode: " << ID_EX.opcode << endl;
-            cout << "\t\tr1_value: " << ID_EX.r1_val << endl;
-            cout << "\t\tr2_value: " << ID_EX.r2_val << endl;
-            cout << "\t\tr3_value: " << ID_EX.r3_val << endl;
+            cout << "\t\topcode: " << ID_EX.inst.opcode << endl;
+            cout << "\t\trs_value: " << ID_EX.rs_val << endl;
+            cout << "\t\trt_value: " << ID_EX.rt_val << endl;
+            cout << "\t\timmediate: " << ID_EX.inst.imm << endl;
             cout << endl;
         }
         else if (stage==3)
         {
             cout << "\tMEM STAGE" << endl;
-            cout << "\t\topcode: " << EX_MEM.opcode << endl;
-            cout << "\t\tr1: " << EX_MEM.reg1 << endl;
-            cout << "\t\tr2: " << EX_MEM.reg2 << endl;
+            cout << "\t\topcode: " << EX_MEM.inst.opcode << endl;
+            cout << "\t\trd: " << EX_MEM.inst.rd << endl;
+            cout << "\t\trt: " << EX_MEM.inst.rt << endl;
             cout << "\t\tresult: " << EX_MEM.result << endl;
             cout << endl;
         }
         else if (stage==4)
         {
             cout << "\tWB STAGE" << endl;
-            cout << "\t\topcode: " << MEM_WB.opcode << endl;
-            cout << "\t\tr1: " << MEM_WB.reg1 << endl;
+            cout << "\t\topcode: " << MEM_WB.inst.opcode << endl;
+            cout << "\t\trd: " << MEM_WB.inst.rd << endl;
             cout << "\t\tresult: " << MEM_WB.result << endl;
             cout << "\t\tdata: " << MEM_WB.data << endl;
             cout << endl;
@@ -826,23 +1392,184 @@ struct MIPS_Architecture
 
 };
 
-int main(int argc, char *argv[])
+// everything a run is set up with, from configuration files, flags and the positional arguments
+struct Settings
+{
+	string program;
+	string policy;
+	bool check = false;
+	bool stream = false;
+	bool unified = false;
+	// what the predict policy follows for a branch waiting on a load: its table of 2^predictorBits
+	// counters starting at predictorInit, or a fixed guess
+	string predictor = "saturating";
+	int predictorBits = 14;
+	int predictorInit = 1;
+	int memoryBytes = MIPS_Architecture<StallPolicy>::DEFAULT_MEMORY;
+	int dmaBandwidth = 1;
+	string output = "cycles";
+	// "-" or empty for no file
+	string stats;
+	int sampleInterval = 0;
+	string profile;
+	string trace;
+	// "-" for standard error
+	string result;
+	RunLimits limits;
+};
+
+const char *const SETTINGS[] = {"program", "policy", "check", "stream", "unified", "predictor", "predictor-bits", "predictor-init", "memory", "dma-bandwidth", "output",
+								"stats", "sample-interval", "profile", "trace", "result", "max-cycles", "max-instructions", "time-limit", "watchdog"};
+// what the positional arguments set, in order
+const char *const POSITIONAL[] = {"program", "stats", "sample-interval", "profile", "trace"};
+
+// fill settings from options, false with options.error set at the first invalid value
+bool configure(Options &options, Settings &settings)
+{
+	bool valid = options.text("program", settings.program) && options.choice("policy", settings.policy, {"stall", "forward", "predict"}) &&
+				 options.boolean("check", settings.check) && options.boolean("stream", settings.stream) && options.boolean("unified", settings.unified) &&
+				 options.choice("predictor", settings.predictor, {"saturating", "taken", "not-taken"}) &&
+				 options.integer("predictor-bits", settings.predictorBits, 1, 20) && options.integer("predictor-init", settings.predictorInit, 0, 3) &&
+				 options.integer("memory", settings.memoryBytes, 4096, 1 << 30) && options.integer("dma-bandwidth", settings.dmaBandwidth, 1, 1 << 20) &&
+				 options.choice("output", settings.output, {"cycles", "final", "none"}) && options.text("stats", settings.stats) &&
+				 options.integer("sample-interval", settings.sampleInterval, 0, INT_MAX) && options.text("profile", settings.profile) &&
+				 options.text("trace", settings.trace) && options.text("result", settings.result) &&
+				 options.integer("max-cycles", settings.limits.maxCycles, 0, LLONG_MAX) && options.integer("max-instructions", settings.limits.maxInstructions, 0, LLONG_MAX) &&
+				 options.number("time-limit", settings.limits.maxSeconds) && options.boolean("watchdog", settings.limits.watchdog);
+	if (valid && settings.memoryBytes % 4)
+	{
+		options.error = options.origin["memory"] + ": memory must be a whole number of words";
+		valid = false;
+	}
+	return valid;
+}
+
+bool given(const string &path)
+{
+	return !path.empty() && path != "-";
+}
+
+// build the pipeline for one hazard policy and run it, reading the program from stream instead of
+// file when given. returns how the run ended
+template <class Hazard>
+RunResult simulate(const Settings &settings, MappedFile &file, LineReader *stream)
 {
-	if (argc != 2)
+	// a pre-assembled image or an ELF executable is decoded once, for the pipeline and the functional model
+	Program program;
+	bool binary = !stream && (Program::isImage(file.view()) || Program::isElf(file.view()));
+	if (binary && Program::isImage(file.view()))
+		program.loadImage(file.view());
+	else if (binary)
+		program.loadElf(file.view());
+	auto build = [&]()
+	{ return binary ? new MIPS_Architecture<Hazard>(program, settings.memoryBytes) : new MIPS_Architecture<Hazard>(file, settings.memoryBytes); };
+	MIPS_Architecture<Hazard> *mips = build();
+	mips->sourceName = settings.program == "-" ? "<stdin>" : settings.program;
+	if (stream)
+	{
+		// only the part of a streamed program still ahead is kept, there is nothing to list or replay
+		if (settings.check || settings.unified || given(settings.profile))
+		{
+			std::cerr << "A streamed program cannot be checked, profiled or placed in unified memory. Terminating...\n";
+			return RunResult::setupError("a streamed program cannot be checked, profiled or placed in unified memory");
+		}
+		mips->commands.stream(*stream, mips->address);
+	}
+	if (settings.check)
+	{
+		mips->golden = build();
+		mips->golden->deviceReads = &mips->lastDeviceRead;
+	}
+	if (settings.unified)
 	{
-		std::cerr << "Required argument: file_name\n./MIPS_interpreter <file name>\n";
-		return 0;
+		mips->loadCode();
+		if (mips->golden)
+			mips->golden->loadCode();
 	}
-	std::ifstream file(argv[1]);
-	MIPS_Architecture *mips;
-	if (file.is_open())
-		mips = new MIPS_Architecture(file);
+	if (settings.predictor == "saturating")
+		mips->predictor = make_unique<SaturatingBranchPredictor>(settings.predictorInit, settings.predictorBits);
 	else
+		mips->predictor = make_unique<StaticBranchPredictor>(settings.predictor == "taken");
+	mips->devices.bandwidth = settings.dmaBandwidth;
+	mips->output = settings.output == "cycles" ? mips->OUTPUT_CYCLES : settings.output == "final" ? mips->OUTPUT_FINAL : mips->OUTPUT_NONE;
+	if (given(settings.stats))
+		mips->statsPath = settings.stats;
+	mips->perf.sampleInterval = settings.sampleInterval;
+	if (given(settings.profile))
 	{
-		std::cerr << "File could not be opened. Terminating...\n";
-		return 0;
+		mips->profilePath = settings.profile;
+		mips->profiling = true;
+		mips->profile.resize(mips->commands.size());
 	}
-
+	if (given(settings.trace) && !mips->trace.open(settings.trace))
+	{
+		std::cerr << "Trace file could not be opened. Terminating...\n";
+		return RunResult::setupError("trace file " + settings.trace + " could not be opened");
+	}
+	mips->limits = settings.limits;
 	mips->executeCommandsPipelined();
-	return 0;
+	return mips->result;
+}
+
+int main(int argc, char *argv[])
+{
+	// the binary name picks the default policy, 5stage_bypass forwards
+	string binary = argv[0];
+	Settings settings;
+	settings.policy = binary.substr(binary.rfind('/') + 1).find("bypass") != string::npos ? "forward" : "stall";
+	Options options(SETTINGS);
+	// every argument is read so --result is known even when an earlier one is bad, the first error is reported
+	string error;
+	int positional = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		bool valid;
+		if (arg.rfind("--", 0) == 0)
+			valid = options.parseFlag(arg);
+		else if (positional < 5)
+			valid = options.set(POSITIONAL[positional++], arg, "argument " + to_string(i));
+		else
+			valid = false, options.error = "too many arguments";
+		if (!valid && error.empty())
+			error = options.error;
+	}
+	options.text("result", settings.result);
+	if (error.empty() && !configure(options, settings))
+		error = options.error;
+	if (error.empty() && settings.program.empty())
+		error = "no program given";
+
+	RunResult result;
+	// standard input is always streamed, the program may still be being generated
+	bool stream = settings.stream || settings.program == "-";
+	MappedFile file;
+	LineReader reader;
+	if (!error.empty())
+	{
+		std::cerr << error << '\n';
+		std::cerr << "Required argument: file_name\n./MIPS_interpreter [--key=value...] <file name | -> [statistics.json|statistics.csv] [sample interval] [profile.txt] [trace.kanata]\n"
+					 "settings, as --key=value (--key for true, --no-key for false) or as key = value lines of a --config=file, later ones win:\n"
+					 "  policy=stall|forward|predict  check  stream  unified\n"
+					 "  predictor=saturating|taken|not-taken  predictor-bits=1..20  predictor-init=0..3\n"
+					 "  memory=bytes  dma-bandwidth=words per cycle  output=cycles|final|none\n"
+					 "  program=file  stats=file  sample-interval=cycles  profile=file  trace=file  result=file|-\n"
+					 "  max-cycles=N  max-instructions=N  time-limit=seconds  watchdog\n";
+		result = RunResult::setupError(error);
+	}
+	else if (stream ? !reader.open(settings.program.c_str()) : !file.load(settings.program.c_str()))
+	{
+		std::cerr << "File could not be opened. Terminating...\n";
+		result = RunResult::setupError("program " + settings.program + " could not be opened");
+	}
+	else if (settings.policy == "stall")
+		result = simulate<StallPolicy>(settings, file, stream ? &reader : nullptr);
+	else if (settings.policy == "forward")
+		result = simulate<ForwardingPolicy>(settings, file, stream ? &reader : nullptr);
+	else
+		result = simulate<PredictorPolicy>(settings, file, stream ? &reader : nullptr);
+	if (!settings.result.empty() && !result.write(settings.result))
+		std::cerr << "Could not write the result to " << settings.result << '\n';
+	// anything but a finished run fails so scripts can check every program
+	return result.status;
 }
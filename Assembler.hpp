@@ -0,0 +1,236 @@
+#ifndef __ASSEMBLER_HPP__
+#define __ASSEMBLER_HPP__
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// read-only view of a whole input file, mmap'd when possible and read into memory otherwise (pipes)
+struct MappedFile {
+    const char *data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+    bool open = false;
+    std::string buffer;
+
+    MappedFile() {}
+    MappedFile(const char *path) { load(path); }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile() {
+        if (mapped)
+            munmap((void *)data, size);
+    }
+
+    bool load(const char *path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, st.st_size, MADV_SEQUENTIAL);
+                data = (const char *)p;
+                size = st.st_size;
+                mapped = true;
+            }
+        }
+        if (!mapped) {
+            char chunk[1 << 16];
+            ssize_t n;
+            while ((n = read(fd, chunk, sizeof chunk)) > 0)
+                buffer.append(chunk, n);
+            data = buffer.data();
+            size = buffer.size();
+        }
+        close(fd);
+        open = true;
+        return true;
+    }
+
+    bool is_open() const { return open; }
+    std::string_view view() const { return std::string_view(data, size); }
+};
+
+// lines of a file or a pipe read a block at a time as they are asked for, so input that is still
+// being written can be consumed. "-" reads standard input
+struct LineReader {
+    int fd = -1;
+    bool eof = false;
+    std::string buffer;
+    size_t start = 0;
+
+    LineReader() {}
+    LineReader(const LineReader &) = delete;
+    LineReader &operator=(const LineReader &) = delete;
+    ~LineReader() {
+        if (fd > 0)
+            close(fd);
+    }
+
+    bool open(const char *path) {
+        fd = std::string(path) == "-" ? 0 : ::open(path, O_RDONLY);
+        return fd >= 0;
+    }
+
+    // the next line without its newline, false once the input is exhausted.
+    // the view is only valid until the next call
+    bool next(std::string_view &line) {
+        for (;;) {
+            size_t eol = buffer.find('\n', start);
+            if (eol != std::string::npos || (eof && start < buffer.size())) {
+                size_t end = eol == std::string::npos ? buffer.size() : eol;
+                line = std::string_view(buffer).substr(start, end - start);
+                start = end + 1;
+                return true;
+            }
+            if (eof)
+                return false;
+            buffer.erase(0, start);
+            start = 0;
+            char chunk[1 << 16];
+            ssize_t n = read(fd, chunk, sizeof chunk);
+            if (n <= 0)
+                eof = true;
+            else
+                buffer.append(chunk, n);
+        }
+    }
+};
+
+typedef std::array<std::string_view, 4> Tokens;
+
+// single pass tokenizer over the whole input, tokens are views into the input buffer
+// which therefore has to outlive the assembler
+struct Assembler {
+    std::vector<Tokens> commands;
+    std::unordered_map<std::string_view, int> address;
+    // source line of every command, 1-based
+    std::vector<int> lineOf;
+    std::vector<std::string_view> scratch;
+
+    static bool isSeparator(char c) { return c == ',' || c == ' ' || c == '\t'; }
+
+    // calls emit(commands.back()) for every instruction as soon as it is parsed
+    template <class Emit>
+    void parse(std::string_view text, Emit emit) {
+        int line = 0;
+        while (!text.empty()) {
+            size_t eol = text.find('\n');
+            std::string_view current = text.substr(0, eol);
+            text = eol == std::string_view::npos ? std::string_view() : text.substr(eol + 1);
+            ++line;
+            if (parseLine(current, line))
+                emit(commands.back());
+        }
+    }
+
+    // returns true if the line holds an instruction, labels follow the rules of the original parser
+    bool parseLine(std::string_view line, int lineNumber) {
+        // strip until before the comment begins
+        line = line.substr(0, line.find('#'));
+        std::vector<std::string_view> &command = scratch;
+        command.clear();
+        for (size_t i = 0; i < line.size();) {
+            if (isSeparator(line[i])) {
+                ++i;
+                continue;
+            }
+            size_t j = i;
+            while (j < line.size() && !isSeparator(line[j]))
+                ++j;
+            command.push_back(line.substr(i, j - i));
+            i = j;
+        }
+        size_t first = 0;
+        // empty line or a comment only line
+        if (command.empty())
+            return false;
+        else if (command.size() == 1) {
+            defineLabel(command[0].back() == ':' ? command[0].substr(0, command[0].size() - 1) : "?");
+            return false;
+        }
+        else if (command[0].back() == ':') {
+            defineLabel(command[0].substr(0, command[0].size() - 1));
+            first = 1;
+        }
+        else if (command[0].find(':') != std::string_view::npos) {
+            size_t idx = command[0].find(':');
+            defineLabel(command[0].substr(0, idx));
+            command[0] = command[0].substr(idx + 1);
+        }
+        else if (command[1][0] == ':') {
+            defineLabel(command[0]);
+            command[1] = command[1].substr(1);
+            first = command[1].empty() ? 2 : 1;
+        }
+        if (first == command.size())
+            return false;
+        Tokens tokens;
+        for (size_t i = first; i < command.size() && i - first < 4; ++i)
+            tokens[i - first] = command[i];
+        // anything past the fourth operand stays attached to it
+        if (command.size() - first > 4)
+            tokens[3] = std::string_view(tokens[3].data(), command.back().data() + command.back().size() - tokens[3].data());
+        commands.push_back(tokens);
+        lineOf.push_back(lineNumber);
+        return true;
+    }
+
+    // 1-based column of every token of a command on the line starting at lineStart. a missing
+    // operand is placed just past the last token, where it would have been written
+    static std::array<int, 4> columnsOf(const Tokens &tokens, const char *lineStart) {
+        std::array<int, 4> columns{};
+        int end = 1;
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            if (tokens[i].data() == nullptr) {
+                columns[i] = end + 1;
+                continue;
+            }
+            columns[i] = int(tokens[i].data() - lineStart) + 1;
+            end = columns[i] + int(tokens[i].size());
+        }
+        return columns;
+    }
+
+    void defineLabel(std::string_view label) {
+        auto it = address.find(label);
+        if (it == address.end())
+            address.emplace(label, commands.size());
+        else
+            it->second = -1;
+    }
+
+    // stoi compatible: optional sign, at least one digit, trailing characters ignored
+    static bool parseInt(std::string_view s, int &value) {
+        size_t i = 0;
+        while (i < s.size() && isspace((unsigned char)s[i]))
+            ++i;
+        bool negative = false;
+        if (i < s.size() && (s[i] == '-' || s[i] == '+'))
+            negative = s[i++] == '-';
+        if (i == s.size() || !isdigit((unsigned char)s[i]))
+            return false;
+        long long v = 0;
+        for (; i < s.size() && isdigit((unsigned char)s[i]); ++i) {
+            v = v * 10 + (s[i] - '0');
+            if (v > (long long)INT_MAX + 1)
+                return false;
+        }
+        v = negative ? -v : v;
+        if (v > INT_MAX || v < INT_MIN)
+            return false;
+        value = (int)v;
+        return true;
+    }
+};
+
+#endif
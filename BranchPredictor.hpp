@@ -6,16 +6,29 @@
 #include <cassert>
 
 struct BranchPredictor {
+    virtual ~BranchPredictor() {}
     virtual bool predict(uint32_t pc) = 0;
     virtual void update(uint32_t pc, bool taken) = 0;
 };
 
+// predicts every branch the same way, the baseline the others are measured against
+struct StaticBranchPredictor : public BranchPredictor {
+    bool taken;
+    StaticBranchPredictor(bool taken) : taken(taken) {}
+
+    bool predict(uint32_t pc) { return taken; }
+    void update(uint32_t pc, bool taken) {}
+};
+
+// a table of 2-bit counters indexed by the low bits of the pc. callers pass the instruction index, the
+// byte address shifted right by 2, so every counter of the table is in use
 struct SaturatingBranchPredictor : public BranchPredictor {
     std::vector<std::bitset<2>> table;
-    SaturatingBranchPredictor(int value) : table(1 << 14, value) {}
+    uint32_t mask;
+    SaturatingBranchPredictor(int value, int bits = 14) : table(1 << bits, value), mask((1u << bits) - 1) {}
 
     bool predict(uint32_t pc) {
-        int index = (pc & ((1 << 14) - 1));
+        int index = pc & mask;
         if (table[index].to_ulong() == 0 || table[index].to_ulong() == 1)
             return false;
         else
@@ -24,7 +37,7 @@ struct SaturatingBranchPredictor : public BranchPredictor {
     }
 
     void update(uint32_t pc, bool taken) {
-        int index = (pc & ((1 << 14) - 1));
+        int index = pc & mask;
         if (taken)
         {
             if (table[index].to_ulong() == 0)
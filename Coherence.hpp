@@ -0,0 +1,143 @@
+#ifndef __COHERENCE_HPP__
+#define __COHERENCE_HPP__
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+
+enum MESIState {
+    INVALID = 0,
+    SHARED,
+    EXCLUSIVE,
+    MODIFIED
+};
+
+struct CoherenceCounters {
+    long long hits = 0;
+    long long misses = 0;
+    long long upgrades = 0;
+    long long invalidationsSent = 0;
+    long long writebacks = 0;
+    long long cacheToCache = 0;
+};
+
+// word-addressed memory shared by every core, with a direct-mapped private cache per core kept
+// coherent by MESI snooping over a bus that is serialised by a lock.
+// a cache line's tag and state are packed into one atomic word so hits never take the lock and
+// other cores can downgrade or invalidate it concurrently
+struct CoherentMemory {
+    int cores;
+    int lineWords;
+    int sets;
+    int hitLatency;
+    int missLatency;
+    int transferLatency;
+    std::unique_ptr<std::atomic<int>[]> data;
+    std::vector<std::unique_ptr<std::atomic<int>[]>> lines;
+    std::vector<CoherenceCounters> counters;
+    std::mutex bus;
+
+    CoherentMemory(int words, int cores, int sets, int lineWords, int missLatency)
+        : cores(cores), lineWords(lineWords), sets(sets), hitLatency(1), missLatency(missLatency),
+          transferLatency((missLatency + 1) / 2), data(new std::atomic<int>[words]()), counters(cores) {
+        for (int c = 0; c < cores; ++c) {
+            lines.emplace_back(new std::atomic<int>[sets]);
+            for (int s = 0; s < sets; ++s)
+                lines[c][s].store(INVALID, std::memory_order_relaxed);
+        }
+    }
+
+    static int pack(int tag, int state) { return (tag << 2) | state; }
+    static int tagOf(int line) { return line >> 2; }
+    static int stateOf(int line) { return line & 3; }
+
+    int read(int core, int index, int &latency) {
+        latency = access(core, index, false);
+        return data[index].load(std::memory_order_relaxed);
+    }
+
+    // only the bits in mask are replaced, the merge is atomic so concurrent sub-word stores
+    // to other lanes of the same word are not lost
+    void write(int core, int index, int value, int &latency, uint32_t mask = ~0u) {
+        latency = access(core, index, true);
+        if (mask == ~0u) {
+            data[index].store(value, std::memory_order_relaxed);
+            return;
+        }
+        int current = data[index].load(std::memory_order_relaxed);
+        while (!data[index].compare_exchange_weak(current, int((uint32_t(current) & ~mask) | (uint32_t(value) & mask)),
+                                                  std::memory_order_relaxed))
+            ;
+    }
+
+    // returns the latency of the access in cycles and leaves the line in a state that permits it
+    int access(int core, int index, bool write) {
+        int block = index / lineWords, set = block % sets, tag = block / sets;
+        std::atomic<int> &line = lines[core][set];
+        int current = line.load(std::memory_order_acquire);
+        if (tagOf(current) == tag) {
+            int state = stateOf(current);
+            if (!write && state != INVALID) {
+                ++counters[core].hits;
+                return hitLatency;
+            }
+            if (write && state == MODIFIED) {
+                ++counters[core].hits;
+                return hitLatency;
+            }
+            // silent E -> M upgrade, unless another core snooped the line in the meantime
+            if (write && state == EXCLUSIVE && line.compare_exchange_strong(current, pack(tag, MODIFIED)))
+            {
+                ++counters[core].hits;
+                return hitLatency;
+            }
+        }
+        return snoop(core, set, tag, write);
+    }
+
+    int snoop(int core, int set, int tag, bool write) {
+        std::lock_guard<std::mutex> lock(bus);
+        CoherenceCounters &counter = counters[core];
+        std::atomic<int> &line = lines[core][set];
+        int current = line.load(std::memory_order_acquire);
+        bool upgrade = tagOf(current) == tag && stateOf(current) != INVALID;
+        if (!upgrade && stateOf(current) == MODIFIED)
+            ++counter.writebacks;
+        bool shared = false, supplied = false;
+        for (int c = 0; c < cores; ++c) {
+            if (c == core)
+                continue;
+            std::atomic<int> &other = lines[c][set];
+            int theirs = other.load(std::memory_order_acquire);
+            if (tagOf(theirs) != tag || stateOf(theirs) == INVALID)
+                continue;
+            if (stateOf(theirs) == MODIFIED)
+                ++counter.writebacks, supplied = true;
+            else if (stateOf(theirs) == EXCLUSIVE)
+                supplied = true;
+            if (write) {
+                other.store(pack(tag, INVALID), std::memory_order_release);
+                ++counter.invalidationsSent;
+            }
+            else {
+                other.store(pack(tag, SHARED), std::memory_order_release);
+                shared = true;
+            }
+        }
+        line.store(pack(tag, write ? MODIFIED : shared ? SHARED : EXCLUSIVE), std::memory_order_release);
+        if (upgrade) {
+            ++counter.upgrades;
+            return hitLatency;
+        }
+        ++counter.misses;
+        if (supplied) {
+            ++counter.cacheToCache;
+            return transferLatency;
+        }
+        return missLatency;
+    }
+};
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef __COMMAND_STREAM_HPP__
+#define __COMMAND_STREAM_HPP__
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <unordered_map>
+#include "Program.hpp"
+
+// the path an instruction takes through the 5-stage pipeline, worked out once when it is decoded so
+// the stages never look at the opcode to find it. the first three write a result computed in EX
+enum Kind : uint8_t {
+    KIND_REGISTER, // three registers, div included
+    KIND_IMMEDIATE, // a destination, a source and an immediate, lui, mfhi and mflo included
+    KIND_LINK,     // jal
+    KIND_LOAD,
+    KIND_STORE,
+    KIND_BRANCH,
+    KIND_JUMP,
+    KIND_JUMP_REGISTER
+};
+
+inline Kind kindOf(const Instruction &inst) {
+    switch (inst.opcode) {
+    case OP_ADDI:
+    case OP_SLL:
+    case OP_SRL:
+    case OP_SRA:
+    case OP_ANDI:
+    case OP_ORI:
+    case OP_LUI:
+    case OP_SLTI:
+    case OP_MFHI:
+    case OP_MFLO:
+        return KIND_IMMEDIATE;
+    case OP_JAL:
+        return KIND_LINK;
+    case OP_J:
+        return KIND_JUMP;
+    case OP_JR:
+        return KIND_JUMP_REGISTER;
+    default:
+        return inst.isLoad() ? KIND_LOAD : inst.isStore() ? KIND_STORE : inst.isBranch() ? KIND_BRANCH : KIND_REGISTER;
+    }
+}
+
+// whether the instruction writes rd, with a result from EX or from a load
+inline bool writesResult(Kind kind) { return kind <= KIND_LINK; }
+inline bool writesRegister(Kind kind) { return kind <= KIND_LOAD; }
+
+// the commands of a program by index, either all parsed up front or pulled from a LineReader as
+// execution reaches them. a streamed program only keeps the commands it may still run: the ones from
+// the fetch point on, and everything after the first label or jal since control can come back there
+struct CommandStream {
+    // commands are dropped this many at a time
+    static const int RELEASE_CHUNK = 4096;
+
+    // a command decoded as it is parsed
+    struct Command {
+        Instruction inst;
+        Kind kind = KIND_REGISTER;
+        // the command as written, for the trace, the profile and error messages
+        std::string text;
+        // source line, and the column each token starts at
+        int line;
+        std::array<int, 4> column{};
+        // the first bad operand, if any
+        Program::DecodeError error;
+        // label a beq, bne, j or jal goes to, inst.target is only valid once it is checked
+        std::string label;
+        // whether decode has checked the command and resolved its label
+        bool checked = false;
+        // a store has rewritten the word holding it in unified memory, fetch decodes it again
+        bool stale = false;
+    };
+
+    std::deque<Command> window;
+    // index of window.front()
+    int first = 0;
+    // commands from here on are never dropped
+    int keepFrom = 0;
+
+    LineReader *input = nullptr;
+    std::unordered_map<std::string, int> *labels = nullptr;
+    Assembler assembler;
+    int lineNumber = 0;
+
+    // commands parsed so far
+    int size() const { return first + int(window.size()); }
+    Command &command(int pc) { return window[pc - first]; }
+    int lineOf(int pc) const { return window[pc - first].line; }
+    bool streaming() const { return input != nullptr; }
+    // whether every command of the program has been read
+    bool complete() const { return !input || input->eof; }
+
+    // decode the next command, jal links to the one after it
+    void push(const Tokens &tokens, int line, const char *lineStart) {
+        window.emplace_back();
+        Command &command = window.back();
+        command.line = line;
+        command.column = Assembler::columnsOf(tokens, lineStart);
+        command.text = std::string(tokens[0]);
+        for (int i = 1; i < 4 && !tokens[i].empty(); ++i)
+            (command.text += i == 1 ? " " : ", ") += tokens[i];
+        Program::decodeCommand(tokens, command.inst, &command.error);
+        command.kind = kindOf(command.inst);
+        if (command.inst.isBranch())
+            command.label = std::string(tokens[3]);
+        else if (command.inst.opcode == OP_J || command.inst.opcode == OP_JAL)
+            command.label = std::string(tokens[1]);
+        if (command.inst.opcode == OP_JAL)
+            command.inst.imm = 4 * size();
+    }
+
+    // take a command decoded elsewhere, from a program image or an executable, targets resolved
+    void push(const Instruction &inst, std::string text) {
+        window.emplace_back();
+        Command &command = window.back();
+        command.inst = inst;
+        command.kind = kindOf(inst);
+        command.line = 0;
+        command.text = std::move(text);
+        command.checked = true;
+    }
+
+    // read the program from input as it is needed, labels it defines go into labels
+    void stream(LineReader &source, std::unordered_map<std::string, int> &labelMap) {
+        input = &source;
+        labels = &labelMap;
+        keepFrom = INT_MAX;
+    }
+
+    // whether command pc exists, reading up to it if necessary
+    bool has(int pc) {
+        while (pc >= size())
+            if (!pull())
+                return false;
+        return pc >= first;
+    }
+
+    // read lines up to the next command, false at the end of the input
+    bool pull() {
+        std::string_view line;
+        while (input && input->next(line)) {
+            bool parsed = assembler.parseLine(line, ++lineNumber);
+            // the assembler numbers labels from its own empty command list, the stream continues from size()
+            for (auto &label : assembler.address) {
+                auto it = labels->find(std::string(label.first));
+                if (it == labels->end())
+                    labels->emplace(std::string(label.first), size() + label.second);
+                else
+                    it->second = -1;
+                keepFrom = std::min(keepFrom, size());
+            }
+            assembler.address.clear();
+            if (!parsed)
+                continue;
+            push(assembler.commands.back(), lineNumber, line.data());
+            assembler.commands.clear();
+            assembler.lineOf.clear();
+            if (window.back().inst.opcode == OP_JAL)
+                keepFrom = std::min(keepFrom, size());
+            return true;
+        }
+        return false;
+    }
+
+    // nothing before pc will run again, drop what is not kept for labels and return addresses
+    void release(int pc) {
+        int end = std::min(pc, keepFrom);
+        if (end - first < RELEASE_CHUNK)
+            return;
+        window.erase(window.begin(), window.begin() + (end - first));
+        first = end;
+    }
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef __DEVICES_HPP__
+#define __DEVICES_HPP__
+
+#include <ostream>
+
+// memory-mapped devices occupying the last SIZE bytes of data memory, accessed by whole words only.
+// a console, counters for self-measurement and a DMA engine copying words while the program runs
+struct Devices {
+    static const int SIZE = 256;
+    // byte offsets of the device registers from base
+    enum Register {
+        CONSOLE_CHAR = 0x00, // write: print the low byte as a character
+        CONSOLE_INT = 0x04,  // write: print the value in decimal and a newline
+        CYCLES = 0x08,       // read: cycles since the start of the run
+        INSTRUCTIONS = 0x0c, // read: instructions issued so far
+        DMA_SOURCE = 0x10,   // byte address of the block to copy
+        DMA_DEST = 0x14,     // byte address to copy it to
+        DMA_LENGTH = 0x18,   // bytes to copy, a multiple of 4
+        DMA_CONTROL = 0x1c   // write 1: start the copy. read: IDLE, BUSY or FAILED
+    };
+    enum DmaStatus {
+        IDLE = 0,
+        BUSY,
+        FAILED // the last copy was misaligned or overlapped the program or the devices
+    };
+
+    int base;
+    // lowest byte address programs may access, the program itself sits below it
+    int dataStart = 0;
+    std::ostream *console;
+    long long cycles = 0;
+    long long instructions = 0;
+
+    int source = 0, dest = 0, length = 0;
+    DmaStatus status = IDLE;
+    // words the DMA engine moves per cycle
+    int bandwidth = 1;
+
+    Devices(int memoryBytes, std::ostream &console) : base(memoryBytes - SIZE), console(&console) {}
+
+    bool contains(int address) const { return address >= base; }
+
+    int read(int address) const {
+        switch (address - base) {
+        case CYCLES:
+            return int(cycles);
+        case INSTRUCTIONS:
+            return int(instructions);
+        case DMA_SOURCE:
+            return source;
+        case DMA_DEST:
+            return dest;
+        case DMA_LENGTH:
+            return length;
+        case DMA_CONTROL:
+            return status;
+        default:
+            return 0;
+        }
+    }
+
+    void write(int address, int value) {
+        switch (address - base) {
+        case CONSOLE_CHAR:
+            console->put(char(value));
+            break;
+        case CONSOLE_INT:
+            *console << value << '\n';
+            break;
+        case DMA_SOURCE:
+            source = value;
+            break;
+        case DMA_DEST:
+            dest = value;
+            break;
+        case DMA_LENGTH:
+            length = value;
+            break;
+        case DMA_CONTROL:
+            if (value == 1 && status != BUSY)
+                status = valid(source) && valid(dest) ? BUSY : FAILED;
+            break;
+        default:
+            break;
+        }
+    }
+
+    // called once per cycle, copy(from, to) moves one word given by its index
+    template <class Copy>
+    void tick(Copy copy) {
+        for (int i = 0; i < bandwidth && status == BUSY; ++i) {
+            if (length > 0) {
+                copy(source / 4, dest / 4);
+                source += 4, dest += 4, length -= 4;
+            }
+            if (length <= 0)
+                status = IDLE;
+        }
+    }
+
+  private:
+    // written as a difference so a length near INT_MAX cannot wrap around
+    bool valid(int start) const {
+        return start % 4 == 0 && length % 4 == 0 && length >= 0 && start >= dataStart && length <= base - start;
+    }
+};
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef __ELF_HPP__
+#define __ELF_HPP__
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <vector>
+#include "Instruction.hpp"
+#include "Mips32.hpp"
+
+// a static executable decoded for the simulator
+struct ElfProgram {
+    uint32_t base = 0;  // address of instruction 0, data word i lives at base + 4 * i
+    int entry = 0;
+    bool bigEndian = true;
+    std::vector<Instruction> code;
+    std::vector<std::pair<int32_t, int32_t>> data;
+    int errorIndex = -1;
+    std::string error;
+};
+
+namespace elf {
+
+const uint16_t ET_EXEC = 2;
+const uint16_t EM_MIPS = 8;
+const uint32_t PT_LOAD = 1;
+const uint32_t PF_X = 1;
+const uint32_t PF_W = 2;
+const uint32_t PF_R = 4;
+const uint32_t SHT_PROGBITS = 1;
+const uint32_t SHF_ALLOC = 2;
+const uint32_t SHF_EXECINSTR = 4;
+const int EHDR_SIZE = 52;
+const int PHDR_SIZE = 32;
+const int SHDR_SIZE = 40;
+
+// reads fields of either byte order
+struct Reader {
+    std::string_view file;
+    bool bigEndian;
+
+    bool has(size_t offset, size_t size) const { return offset <= file.size() && size <= file.size() - offset; }
+
+    uint32_t read(size_t offset, int size) const {
+        uint32_t v = 0;
+        for (int i = 0; i < size; ++i) {
+            uint8_t byte = file[offset + (bigEndian ? i : size - 1 - i)];
+            v = v << 8 | byte;
+        }
+        return v;
+    }
+    uint16_t half(size_t offset) const { return read(offset, 2); }
+    uint32_t word(size_t offset) const { return read(offset, 4); }
+};
+
+struct Writer {
+    std::string bytes;
+    bool bigEndian;
+
+    void half(uint16_t v) {
+        if (bigEndian)
+            bytes += char(v >> 8), bytes += char(v);
+        else
+            bytes += char(v), bytes += char(v >> 8);
+    }
+    void word(uint32_t v) {
+        if (bigEndian)
+            half(v >> 16), half(v);
+        else
+            half(v), half(v >> 16);
+    }
+};
+
+// loads every PT_LOAD segment into a window of memoryBytes starting at the lowest executable address,
+// executable sections become decoded instructions and the rest of the window the initial data segment
+inline bool load(std::string_view file, uint32_t memoryBytes, ElfProgram &out) {
+    if (file.size() < EHDR_SIZE || memcmp(file.data(), "\x7f" "ELF", 4) != 0 || file[4] != 1 || (file[5] != 1 && file[5] != 2)) {
+        out.error = "not a 32-bit ELF file";
+        return false;
+    }
+    Reader in{file, file[5] == 2};
+    if (in.half(16) != ET_EXEC || in.half(18) != EM_MIPS) {
+        out.error = "not a MIPS executable";
+        return false;
+    }
+    uint32_t entry = in.word(24), phoff = in.word(28), shoff = in.word(32);
+    uint16_t phnum = in.half(44), shnum = in.half(48);
+    if (!in.has(phoff, (size_t)phnum * PHDR_SIZE) || (shnum && !in.has(shoff, (size_t)shnum * SHDR_SIZE))) {
+        out.error = "truncated headers";
+        return false;
+    }
+
+    // the code is the span of the executable sections, or of the executable segments without section headers
+    uint32_t lo = UINT32_MAX, hi = 0;
+    for (int i = 0; i < shnum; ++i) {
+        size_t sh = shoff + (size_t)i * SHDR_SIZE;
+        uint32_t flags = in.word(sh + 8), addr = in.word(sh + 12), size = in.word(sh + 20);
+        if (in.word(sh + 4) == SHT_PROGBITS && (flags & SHF_ALLOC) && (flags & SHF_EXECINSTR) && size)
+            lo = std::min(lo, addr), hi = std::max(hi, addr + size);
+    }
+    for (int i = 0; i < phnum && lo == UINT32_MAX; ++i) {
+        size_t ph = phoff + (size_t)i * PHDR_SIZE;
+        if (in.word(ph) == PT_LOAD && (in.word(ph + 24) & PF_X))
+            lo = in.word(ph + 8), hi = lo + in.word(ph + 16);
+    }
+    if (lo == UINT32_MAX || lo % 4 || hi % 4) {
+        out.error = "no aligned executable code";
+        return false;
+    }
+    // the headers are not trusted, a span that wraps or outgrows memory would be decoded past its end
+    if (hi < lo || hi - lo > memoryBytes) {
+        out.error = "executable code does not fit in simulated memory";
+        return false;
+    }
+
+    std::vector<uint8_t> memory(memoryBytes, 0);
+    for (int i = 0; i < phnum; ++i) {
+        size_t ph = phoff + (size_t)i * PHDR_SIZE;
+        if (in.word(ph) != PT_LOAD)
+            continue;
+        uint32_t offset = in.word(ph + 4), vaddr = in.word(ph + 8), filesz = in.word(ph + 16), memsz = in.word(ph + 20);
+        if (vaddr < lo || memsz > memoryBytes || vaddr - lo > memoryBytes - memsz || filesz > memsz || !in.has(offset, filesz)) {
+            out.error = "segment does not fit in simulated memory";
+            return false;
+        }
+        memcpy(memory.data() + (vaddr - lo), file.data() + offset, filesz);
+    }
+
+    out.base = lo;
+    out.bigEndian = in.bigEndian;
+    int n = (hi - lo) / 4;
+    if (entry < lo || entry >= hi || entry % 4) {
+        out.error = "entry point outside the code";
+        return false;
+    }
+    out.entry = (entry - lo) / 4;
+    Reader words{std::string_view((const char *)memory.data(), memory.size()), in.bigEndian};
+    out.code.resize(n);
+    for (int i = 0; i < n; ++i)
+        if (!mips32::decode(words.word(4 * i), i, lo, n, out.code[i])) {
+            out.errorIndex = i;
+            out.error = "unsupported instruction";
+            return false;
+        }
+    for (uint32_t i = n; i < memoryBytes / 4; ++i) {
+        int32_t value = words.word(4 * i);
+        if (value)
+            out.data.emplace_back(i, value);
+    }
+    return true;
+}
+
+// executable with one text segment and, if there is any initial data, one data segment
+inline bool write(const char *path, const std::vector<Instruction> &code, const std::vector<std::pair<int32_t, int32_t>> &data,
+                  uint32_t base, int entry, bool bigEndian, std::string &error) {
+    std::vector<uint32_t> words(code.size());
+    for (int i = 0; i < (int)code.size(); ++i)
+        if (!mips32::encode(code[i], i, base, words[i])) {
+            error = "instruction " + std::to_string(i) + " has no 32-bit encoding";
+            return false;
+        }
+    int32_t dataLo = INT32_MAX, dataHi = 0;
+    for (auto &w : data)
+        dataLo = std::min(dataLo, w.first), dataHi = std::max(dataHi, w.first + 1);
+    int phnum = data.empty() ? 1 : 2;
+    uint32_t textOffset = EHDR_SIZE + phnum * PHDR_SIZE, dataOffset = textOffset + 4 * code.size();
+
+    Writer out{std::string(), bigEndian};
+    out.bytes.append("\x7f" "ELF\x01", 5);
+    out.bytes += char(bigEndian ? 2 : 1);
+    out.bytes += char(1);
+    out.bytes.append(9, '\0');
+    out.half(ET_EXEC);
+    out.half(EM_MIPS);
+    out.word(1);
+    out.word(base + 4 * entry);
+    out.word(EHDR_SIZE);
+    out.word(0);
+    out.word(0);
+    out.half(EHDR_SIZE);
+    out.half(PHDR_SIZE);
+    out.half(phnum);
+    out.half(SHDR_SIZE);
+    out.half(0);
+    out.half(0);
+    auto segment = [&](uint32_t offset, uint32_t vaddr, uint32_t size, uint32_t flags)
+    {
+        out.word(PT_LOAD), out.word(offset), out.word(vaddr), out.word(vaddr);
+        out.word(size), out.word(size), out.word(flags), out.word(4);
+    };
+    segment(textOffset, base, 4 * code.size(), PF_R | PF_X);
+    if (!data.empty())
+        segment(dataOffset, base + 4 * dataLo, 4 * (dataHi - dataLo), PF_R | PF_W);
+    for (uint32_t w : words)
+        out.word(w);
+    if (!data.empty()) {
+        std::vector<int32_t> segmentWords(dataHi - dataLo, 0);
+        for (auto &w : data)
+            segmentWords[w.first - dataLo] = w.second;
+        for (int32_t w : segmentWords)
+            out.word(w);
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        error = "cannot open output";
+        return false;
+    }
+    bool ok = fwrite(out.bytes.data(), 1, out.bytes.size(), file) == out.bytes.size();
+    return fclose(file) == 0 && ok;
+}
+
+} // namespace elf
+
+#endif
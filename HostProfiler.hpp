@@ -0,0 +1,87 @@
+#ifndef __HOST_PROFILER_HPP__
+#define __HOST_PROFILER_HPP__
+
+// time spent by the simulator itself in each of its hot paths, measured with the time stamp counter.
+// compiled in only with -DSELF_PROFILE, otherwise HOST_TIMER expands to nothing
+#ifdef SELF_PROFILE
+
+#include <cstdint>
+#include <chrono>
+#include <ostream>
+#include <iomanip>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace hostprof {
+
+enum Slot {
+    IF = 0,
+    ID,
+    EX,
+    MEM,
+    WB,
+    OUTPUT,
+    PARSE,
+    NUM_SLOTS
+};
+
+const char *const names[NUM_SLOTS] = {"IF_Stage", "ID_Stage", "EX_Stage", "MEM_Stage", "WB_Stage", "output", "parsing"};
+
+inline uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct Totals {
+    uint64_t ticks[NUM_SLOTS] = {0};
+    uint64_t calls[NUM_SLOTS] = {0};
+    // both clocks read at startup, the whole run calibrates ticks against nanoseconds
+    uint64_t startTicks = hostprof::ticks();
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+};
+
+inline Totals totals;
+
+struct ScopedTimer {
+    Slot slot;
+    uint64_t start;
+
+    ScopedTimer(Slot slot) : slot(slot), start(ticks()) {}
+    ~ScopedTimer() {
+        totals.ticks[slot] += ticks() - start;
+        ++totals.calls[slot];
+    }
+};
+
+// host nanoseconds per simulated cycle spent in every slot
+inline void report(std::ostream &out, long long cycles) {
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - totals.startTime).count();
+    uint64_t elapsed = ticks() - totals.startTicks;
+    double nsPerTick = elapsed ? ns / elapsed : 1.0;
+    out << "Host profile over " << cycles << " cycles, " << std::fixed << std::setprecision(3) << ns / 1e6 << " ms in total\n";
+    out << std::setw(10) << "slot" << std::setw(14) << "ms" << std::setw(14) << "ns/cycle" << std::setw(12) << "calls" << std::setw(9) << "%" << '\n';
+    for (int s = 0; s < NUM_SLOTS; ++s) {
+        double slotNs = totals.ticks[s] * nsPerTick;
+        out << std::setw(10) << names[s] << std::setw(14) << slotNs / 1e6 << std::setw(14) << (cycles ? slotNs / cycles : 0.0)
+            << std::setw(12) << totals.calls[s] << std::setw(9) << std::setprecision(2) << (ns > 0 ? 100.0 * slotNs / ns : 0.0)
+            << std::setprecision(3) << '\n';
+    }
+}
+
+} // namespace hostprof
+
+#define HOST_TIMER(slot) hostprof::ScopedTimer hostTimer_(hostprof::slot)
+#define HOST_REPORT(out, cycles) hostprof::report(out, cycles)
+
+#else
+
+#define HOST_TIMER(slot)
+#define HOST_REPORT(out, cycles)
+
+#endif
+
+#endif
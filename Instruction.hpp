@@ -0,0 +1,223 @@
+#ifndef __INSTRUCTION_HPP__
+#define __INSTRUCTION_HPP__
+
+#include <cstdint>
+#include <climits>
+#include <string>
+#include <unordered_map>
+#include "Packed.hpp"
+
+enum Opcode : int32_t {
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_BEQ,
+    OP_BNE,
+    OP_SLT,
+    OP_J,
+    OP_LW,
+    OP_SW,
+    OP_ADDI,
+    OP_AND,
+    OP_OR,
+    OP_XOR,
+    OP_NOR,
+    OP_SLL,
+    OP_SRL,
+    OP_SRA,
+    OP_ANDI,
+    OP_ORI,
+    OP_LUI,
+    OP_SLTI,
+    OP_LB,
+    OP_LBU,
+    OP_LH,
+    OP_LHU,
+    OP_SB,
+    OP_SH,
+    OP_JAL,
+    OP_JR,
+    OP_DIV,
+    OP_MFHI,
+    OP_MFLO,
+    // packed instructions, in the order of packed::Op
+    OP_ADDU_QB,
+    OP_ADDU_S_QB,
+    OP_SUBU_QB,
+    OP_SUBU_S_QB,
+    OP_ADDQ_PH,
+    OP_ADDQ_S_PH,
+    OP_SUBQ_PH,
+    OP_SUBQ_S_PH,
+    OP_ADDU_PH,
+    OP_ADDU_S_PH,
+    OP_SUBU_PH,
+    OP_SUBU_S_PH,
+    OP_MUL_PH,
+    OP_MUL_S_PH,
+    NUM_OPCODES
+};
+
+// HI and LO live behind the 32 general purpose registers so the hazard logic treats them like any other
+const int REG_HI = 32;
+const int REG_LO = 33;
+const int NUM_REGISTERS = 34;
+
+// an instruction decoded once at load time
+// registers are indices into the register file, 0 ($zero) doubles as "unused"
+// since it is never written and therefore never causes a hazard
+struct Instruction {
+    Opcode opcode;
+    int rd = 0;      // destination register, LO for div
+    int rs = 0;      // first source (base register for loads/stores, HI/LO for mfhi/mflo)
+    int rt = 0;      // second source (store data for stores)
+    int imm = 0;     // immediate, shift amount, load/store offset or the return address of jal
+    int target = 0;  // branch/jump target as an index into code
+
+    bool isBranch() const { return opcode == OP_BEQ || opcode == OP_BNE; }
+    bool isControl() const { return isBranch() || opcode == OP_J || opcode == OP_JAL || opcode == OP_JR; }
+    bool isLoad() const { return opcode == OP_LW || (opcode >= OP_LB && opcode <= OP_LHU); }
+    bool isStore() const { return opcode == OP_SW || opcode == OP_SB || opcode == OP_SH; }
+    bool isMemory() const { return isLoad() || isStore(); }
+    bool isPacked() const { return opcode >= OP_ADDU_QB && opcode <= OP_MUL_S_PH; }
+    // div is the only instruction with a second destination, the remainder in HI
+    int rd2() const { return opcode == OP_DIV ? REG_HI : 0; }
+
+    // bytes touched by a load or store
+    int accessSize() const {
+        if (opcode == OP_LB || opcode == OP_LBU || opcode == OP_SB)
+            return 1;
+        if (opcode == OP_LH || opcode == OP_LHU || opcode == OP_SH)
+            return 2;
+        return 4;
+    }
+};
+
+// mnemonic of every opcode
+inline const std::unordered_map<std::string, Opcode> &opcodeMap() {
+    static std::unordered_map<std::string, Opcode> opcodeMap = {
+        {"add", OP_ADD}, {"sub", OP_SUB}, {"mul", OP_MUL}, {"beq", OP_BEQ}, {"bne", OP_BNE},
+        {"slt", OP_SLT}, {"j", OP_J}, {"lw", OP_LW}, {"sw", OP_SW}, {"addi", OP_ADDI},
+        {"and", OP_AND}, {"or", OP_OR}, {"xor", OP_XOR}, {"nor", OP_NOR}, {"sll", OP_SLL},
+        {"srl", OP_SRL}, {"sra", OP_SRA}, {"andi", OP_ANDI}, {"ori", OP_ORI}, {"lui", OP_LUI},
+        {"slti", OP_SLTI}, {"lb", OP_LB}, {"lbu", OP_LBU}, {"lh", OP_LH}, {"lhu", OP_LHU},
+        {"sb", OP_SB}, {"sh", OP_SH}, {"jal", OP_JAL}, {"jr", OP_JR}, {"div", OP_DIV},
+        {"mfhi", OP_MFHI}, {"mflo", OP_MFLO}};
+    if (opcodeMap.size() < NUM_OPCODES)
+        for (int i = 0; i < packed::NUM_OPS; ++i)
+            opcodeMap[packed::names[i]] = Opcode(OP_ADDU_QB + i);
+    return opcodeMap;
+}
+
+inline const std::string &opcodeName(Opcode opcode) {
+    static std::string names[NUM_OPCODES];
+    if (names[0].empty())
+        for (auto &entry : opcodeMap())
+            names[entry.second] = entry.first;
+    return names[opcode];
+}
+
+// quotient and remainder without trapping, division by zero leaves the dividend in HI
+inline void divide(int a, int b, int &lo, int &hi) {
+    if (b == 0)
+        lo = 0, hi = a;
+    else if (a == INT_MIN && b == -1)
+        lo = INT_MIN, hi = 0;
+    else
+        lo = a / b, hi = a % b;
+}
+
+// result of an ALU instruction given its two operand values
+inline int aluResult(const Instruction &inst, int a, int b) {
+    switch (inst.opcode) {
+    case OP_ADD:
+        return a + b;
+    case OP_SUB:
+        return a - b;
+    case OP_MUL:
+        return a * b;
+    case OP_SLT:
+        return a < b;
+    case OP_ADDI:
+        return a + inst.imm;
+    case OP_AND:
+        return a & b;
+    case OP_OR:
+        return a | b;
+    case OP_XOR:
+        return a ^ b;
+    case OP_NOR:
+        return ~(a | b);
+    case OP_SLL:
+        return int(uint32_t(a) << inst.imm);
+    case OP_SRL:
+        return int(uint32_t(a) >> inst.imm);
+    case OP_SRA:
+        return a >> inst.imm;
+    case OP_ANDI:
+        return a & inst.imm;
+    case OP_ORI:
+        return a | inst.imm;
+    case OP_LUI:
+        return int(uint32_t(inst.imm) << 16);
+    case OP_SLTI:
+        return a < inst.imm;
+    case OP_JAL:
+        return inst.imm;
+    case OP_MFHI:
+    case OP_MFLO:
+        return a;
+    case OP_DIV: {
+        int lo, hi;
+        divide(a, b, lo, hi);
+        return lo;
+    }
+    default:
+        return inst.isPacked() ? packed::apply(packed::Op(inst.opcode - OP_ADDU_QB), a, b) : 0;
+    }
+}
+
+// value written to rd2()
+inline int aluResult2(const Instruction &inst, int a, int b) {
+    int lo, hi;
+    divide(a, b, lo, hi);
+    return hi;
+}
+
+inline bool branchTaken(const Instruction &inst, int a, int b) {
+    return inst.opcode == OP_BEQ ? a == b : a != b;
+}
+
+// sub-word accesses select a lane of the memory word holding them, offset is the byte within that word
+inline int laneShift(int size, int offset, bool bigEndian) {
+    return 8 * (bigEndian ? 4 - size - offset : offset);
+}
+
+inline int loadLane(int word, int size, bool isSigned, int offset, bool bigEndian) {
+    uint32_t v = uint32_t(word) >> laneShift(size, offset, bigEndian);
+    if (size == 1)
+        return isSigned ? int(int8_t(v)) : int(uint8_t(v));
+    if (size == 2)
+        return isSigned ? int(int16_t(v)) : int(uint16_t(v));
+    return word;
+}
+
+inline uint32_t laneMask(int size, int offset, bool bigEndian) {
+    return size == 4 ? ~0u : ((1u << 8 * size) - 1) << laneShift(size, offset, bigEndian);
+}
+
+// the memory word after storing value into one of its lanes
+inline int mergeLane(int word, int value, int size, int offset, bool bigEndian) {
+    uint32_t mask = laneMask(size, offset, bigEndian);
+    return int((uint32_t(word) & ~mask) | ((uint32_t(value) << laneShift(size, offset, bigEndian)) & mask));
+}
+
+inline int loadResult(const Instruction &inst, int word, int offset, bool bigEndian) {
+    return loadLane(word, inst.accessSize(), inst.opcode != OP_LBU && inst.opcode != OP_LHU, offset, bigEndian);
+}
+
+inline int storeResult(const Instruction &inst, int word, int value, int offset, bool bigEndian) {
+    return mergeLane(word, value, inst.accessSize(), offset, bigEndian);
+}
+
+#endif
@@ -0,0 +1,312 @@
+#ifndef __MIPS32_HPP__
+#define __MIPS32_HPP__
+
+#include <cstdint>
+#include "Instruction.hpp"
+
+// MIPS32 machine code for the decoded instruction set
+// instruction indices map to byte addresses base + 4 * index
+namespace mips32 {
+
+enum PrimaryOpcode {
+    SPECIAL = 0x00,
+    J = 0x02,
+    JAL = 0x03,
+    BEQ = 0x04,
+    BNE = 0x05,
+    ADDI = 0x08,
+    ADDIU = 0x09,
+    SLTI = 0x0a,
+    ANDI = 0x0c,
+    ORI = 0x0d,
+    LUI = 0x0f,
+    SPECIAL2 = 0x1c,
+    SPECIAL3 = 0x1f,
+    LB = 0x20,
+    LH = 0x21,
+    LW = 0x23,
+    LBU = 0x24,
+    LHU = 0x25,
+    SB = 0x28,
+    SH = 0x29,
+    SW = 0x2b
+};
+
+enum Funct {
+    FUNCT_SLL = 0x00,
+    FUNCT_SRL = 0x02,
+    FUNCT_SRA = 0x03,
+    FUNCT_JR = 0x08,
+    FUNCT_MFHI = 0x10,
+    FUNCT_MFLO = 0x12,
+    FUNCT_DIV = 0x1a,
+    FUNCT_ADD = 0x20,
+    FUNCT_ADDU = 0x21,
+    FUNCT_SUB = 0x22,
+    FUNCT_SUBU = 0x23,
+    FUNCT_AND = 0x24,
+    FUNCT_OR = 0x25,
+    FUNCT_XOR = 0x26,
+    FUNCT_NOR = 0x27,
+    FUNCT_SLT = 0x2a,
+    FUNCT2_MUL = 0x02
+};
+
+inline uint32_t rType(uint32_t op, uint32_t rs, uint32_t rt, uint32_t rd, uint32_t shamt, uint32_t funct) {
+    return op << 26 | rs << 21 | rt << 16 | rd << 11 | shamt << 6 | funct;
+}
+
+inline uint32_t iType(uint32_t op, uint32_t rs, uint32_t rt, int32_t imm) {
+    return op << 26 | rs << 21 | rt << 16 | (uint32_t(imm) & 0xffff);
+}
+
+inline uint32_t jType(uint32_t op, uint32_t target) {
+    return op << 26 | (target & 0x3ffffff);
+}
+
+// DSP ASE packed instructions live in SPECIAL3, the function field selects a class (ADDU.QB or
+// ADDUH.QB) and the shift amount field the operation within it, indexed by packed::Op
+struct PackedEncoding {
+    uint32_t funct;
+    uint32_t op;
+};
+
+const PackedEncoding packedEncodings[packed::NUM_OPS] = {
+    {0x10, 0x00}, {0x10, 0x04}, {0x10, 0x01}, {0x10, 0x05}, {0x10, 0x0a}, {0x10, 0x0e}, {0x10, 0x0b},
+    {0x10, 0x0f}, {0x10, 0x08}, {0x10, 0x0c}, {0x10, 0x09}, {0x10, 0x0d}, {0x18, 0x0c}, {0x18, 0x0e}};
+
+inline bool fitsImm16(int32_t v) { return v >= -32768 && v <= 32767; }
+inline bool fitsUImm16(int32_t v) { return v >= 0 && v <= 65535; }
+
+// the primary opcode and function field of every instruction that maps one to one onto an encoding
+struct Encoding {
+    uint32_t op;
+    uint32_t funct;
+};
+
+inline Encoding encodingOf(Opcode opcode) {
+    switch (opcode) {
+    case OP_ADD: return {SPECIAL, FUNCT_ADD};
+    case OP_SUB: return {SPECIAL, FUNCT_SUB};
+    case OP_SLT: return {SPECIAL, FUNCT_SLT};
+    case OP_AND: return {SPECIAL, FUNCT_AND};
+    case OP_OR: return {SPECIAL, FUNCT_OR};
+    case OP_XOR: return {SPECIAL, FUNCT_XOR};
+    case OP_NOR: return {SPECIAL, FUNCT_NOR};
+    case OP_SLL: return {SPECIAL, FUNCT_SLL};
+    case OP_SRL: return {SPECIAL, FUNCT_SRL};
+    case OP_SRA: return {SPECIAL, FUNCT_SRA};
+    case OP_MFHI: return {SPECIAL, FUNCT_MFHI};
+    case OP_MFLO: return {SPECIAL, FUNCT_MFLO};
+    case OP_MUL: return {SPECIAL2, FUNCT2_MUL};
+    case OP_ADDI: return {ADDI, 0};
+    case OP_SLTI: return {SLTI, 0};
+    case OP_ANDI: return {ANDI, 0};
+    case OP_ORI: return {ORI, 0};
+    case OP_LUI: return {LUI, 0};
+    case OP_LB: return {LB, 0};
+    case OP_LBU: return {LBU, 0};
+    case OP_LH: return {LH, 0};
+    case OP_LHU: return {LHU, 0};
+    case OP_LW: return {LW, 0};
+    case OP_SB: return {SB, 0};
+    case OP_SH: return {SH, 0};
+    case OP_SW: return {SW, 0};
+    default: return {0, 0};
+    }
+}
+
+// returns false if the instruction has no 32-bit encoding (e.g. an immediate wider than 16 bits,
+// or $hi/$lo named as an ordinary operand)
+inline bool encode(const Instruction &inst, int pc, uint32_t base, uint32_t &word) {
+    Encoding e = encodingOf(inst.opcode);
+    bool gpr = inst.rd < 32 && inst.rs < 32 && inst.rt < 32;
+    if (inst.isPacked()) {
+        const PackedEncoding &p = packedEncodings[inst.opcode - OP_ADDU_QB];
+        word = rType(SPECIAL3, inst.rs, inst.rt, inst.rd, p.op, p.funct);
+        return gpr;
+    }
+    switch (inst.opcode) {
+    case OP_ADD:
+    case OP_SUB:
+    case OP_SLT:
+    case OP_AND:
+    case OP_OR:
+    case OP_XOR:
+    case OP_NOR:
+    case OP_MUL:
+        word = rType(e.op, inst.rs, inst.rt, inst.rd, 0, e.funct);
+        return gpr;
+    case OP_SLL:
+    case OP_SRL:
+    case OP_SRA:
+        word = rType(SPECIAL, 0, inst.rs, inst.rd, inst.imm, e.funct);
+        return gpr;
+    case OP_MFHI:
+    case OP_MFLO:
+        word = rType(SPECIAL, 0, 0, inst.rd, 0, e.funct);
+        return inst.rd < 32;
+    case OP_DIV:
+        word = rType(SPECIAL, inst.rs, inst.rt, 0, 0, FUNCT_DIV);
+        return inst.rs < 32 && inst.rt < 32;
+    case OP_JR:
+        word = rType(SPECIAL, inst.rs, 0, 0, 0, FUNCT_JR);
+        return inst.rs < 32;
+    case OP_ADDI:
+    case OP_SLTI:
+        word = iType(e.op, inst.rs, inst.rd, inst.imm);
+        return gpr && fitsImm16(inst.imm);
+    case OP_ANDI:
+    case OP_ORI:
+        word = iType(e.op, inst.rs, inst.rd, inst.imm);
+        return gpr && fitsUImm16(inst.imm);
+    case OP_LUI:
+        word = iType(LUI, 0, inst.rd, inst.imm);
+        return gpr && fitsUImm16(inst.imm);
+    case OP_BEQ:
+    case OP_BNE:
+        word = iType(inst.opcode == OP_BEQ ? BEQ : BNE, inst.rs, inst.rt, inst.target - (pc + 1));
+        return gpr && fitsImm16(inst.target - (pc + 1));
+    case OP_J:
+    case OP_JAL: {
+        uint32_t next = base + 4 * (pc + 1), target = base + 4 * inst.target;
+        word = jType(inst.opcode == OP_J ? J : JAL, target >> 2);
+        return (next & 0xf0000000) == (target & 0xf0000000);
+    }
+    case OP_LW:
+    case OP_LB:
+    case OP_LBU:
+    case OP_LH:
+    case OP_LHU:
+        word = iType(e.op, inst.rs, inst.rd, inst.imm);
+        return gpr && fitsImm16(inst.imm);
+    case OP_SW:
+    case OP_SB:
+    case OP_SH:
+        word = iType(e.op, inst.rs, inst.rt, inst.imm);
+        return gpr && fitsImm16(inst.imm);
+    default:
+        return false;
+    }
+}
+
+// the SPECIAL function field, addu and subu behave as add and sub since nothing traps on overflow
+inline bool decodeSpecial(uint32_t rs, uint32_t rt, uint32_t rd, uint32_t shamt, uint32_t funct, Instruction &inst) {
+    switch (funct) {
+    case FUNCT_SLL:
+    case FUNCT_SRL:
+    case FUNCT_SRA:
+        inst.opcode = funct == FUNCT_SLL ? OP_SLL : funct == FUNCT_SRL ? OP_SRL : OP_SRA;
+        inst.rd = rd, inst.rs = rt, inst.imm = shamt;
+        return rs == 0;
+    case FUNCT_JR:
+        inst.opcode = OP_JR, inst.rs = rs;
+        return rt == 0 && rd == 0;
+    case FUNCT_MFHI:
+    case FUNCT_MFLO:
+        inst.opcode = funct == FUNCT_MFHI ? OP_MFHI : OP_MFLO;
+        inst.rd = rd, inst.rs = funct == FUNCT_MFHI ? REG_HI : REG_LO;
+        return rs == 0 && rt == 0 && shamt == 0;
+    case FUNCT_DIV:
+        inst.opcode = OP_DIV, inst.rd = REG_LO, inst.rs = rs, inst.rt = rt;
+        return rd == 0 && shamt == 0;
+    case FUNCT_ADD:
+    case FUNCT_ADDU:
+        inst.opcode = OP_ADD;
+        break;
+    case FUNCT_SUB:
+    case FUNCT_SUBU:
+        inst.opcode = OP_SUB;
+        break;
+    case FUNCT_AND:
+        inst.opcode = OP_AND;
+        break;
+    case FUNCT_OR:
+        inst.opcode = OP_OR;
+        break;
+    case FUNCT_XOR:
+        inst.opcode = OP_XOR;
+        break;
+    case FUNCT_NOR:
+        inst.opcode = OP_NOR;
+        break;
+    case FUNCT_SLT:
+        inst.opcode = OP_SLT;
+        break;
+    default:
+        return false;
+    }
+    inst.rd = rd, inst.rs = rs, inst.rt = rt;
+    return shamt == 0;
+}
+
+// bitfield decode of one word, returns false for encodings the simulator does not implement
+// or control transfers that leave the code
+inline bool decode(uint32_t word, int pc, uint32_t base, int codeSize, Instruction &inst) {
+    uint32_t op = word >> 26, rs = (word >> 21) & 31, rt = (word >> 16) & 31, rd = (word >> 11) & 31;
+    uint32_t shamt = (word >> 6) & 31, funct = word & 63;
+    int32_t imm = int16_t(word & 0xffff), uimm = word & 0xffff;
+    inst = Instruction();
+    switch (op) {
+    case SPECIAL:
+        return decodeSpecial(rs, rt, rd, shamt, funct, inst);
+    case SPECIAL2:
+        if (shamt || funct != FUNCT2_MUL)
+            return false;
+        inst.opcode = OP_MUL, inst.rd = rd, inst.rs = rs, inst.rt = rt;
+        return true;
+    case SPECIAL3:
+        for (int i = 0; i < packed::NUM_OPS; ++i)
+            if (packedEncodings[i].funct == funct && packedEncodings[i].op == shamt) {
+                inst.opcode = Opcode(OP_ADDU_QB + i), inst.rd = rd, inst.rs = rs, inst.rt = rt;
+                return true;
+            }
+        return false;
+    case ADDI:
+    case ADDIU:
+        inst.opcode = OP_ADDI, inst.rd = rt, inst.rs = rs, inst.imm = imm;
+        return true;
+    case SLTI:
+        inst.opcode = OP_SLTI, inst.rd = rt, inst.rs = rs, inst.imm = imm;
+        return true;
+    case ANDI:
+    case ORI:
+        inst.opcode = op == ANDI ? OP_ANDI : OP_ORI, inst.rd = rt, inst.rs = rs, inst.imm = uimm;
+        return true;
+    case LUI:
+        inst.opcode = OP_LUI, inst.rd = rt, inst.imm = uimm;
+        return rs == 0;
+    case BEQ:
+    case BNE:
+        inst.opcode = op == BEQ ? OP_BEQ : OP_BNE, inst.rs = rs, inst.rt = rt, inst.target = pc + 1 + imm;
+        return inst.target >= 0 && inst.target <= codeSize;
+    case J:
+    case JAL: {
+        uint32_t target = ((base + 4 * (pc + 1)) & 0xf0000000) | (word & 0x3ffffff) << 2;
+        inst.opcode = op == J ? OP_J : OP_JAL, inst.target = int32_t(target - base) / 4;
+        if (op == JAL)
+            inst.rd = 31, inst.imm = base + 4 * (pc + 1);
+        return target >= base && inst.target <= codeSize && (target - base) % 4 == 0;
+    }
+    case LB:
+    case LBU:
+    case LH:
+    case LHU:
+    case LW:
+        inst.opcode = op == LB ? OP_LB : op == LBU ? OP_LBU : op == LH ? OP_LH : op == LHU ? OP_LHU : OP_LW;
+        inst.rd = rt, inst.rs = rs, inst.imm = imm;
+        return true;
+    case SB:
+    case SH:
+    case SW:
+        inst.opcode = op == SB ? OP_SB : op == SH ? OP_SH : OP_SW;
+        inst.rt = rt, inst.rs = rs, inst.imm = imm;
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace mips32
+
+#endif
@@ -0,0 +1,158 @@
+#ifndef __OPTIONS_HPP__
+#define __OPTIONS_HPP__
+
+#include <cstdlib>
+#include <fstream>
+#include <initializer_list>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+// simulation parameters as key = value settings from configuration files and --key=value flags.
+// a setting replaces any earlier one, so flags after --config=file override what the file says
+struct Options {
+    std::vector<std::string> known;
+    std::map<std::string, std::string> values;
+    // where each value was set, for error messages
+    std::map<std::string, std::string> origin;
+    // what was wrong with the last setting or value that failed
+    std::string error;
+
+    // keys lists every setting there is
+    template <class Keys>
+    explicit Options(const Keys &keys) : known(std::begin(keys), std::end(keys)) {}
+
+    // --key=value, --key for true and --no-key for false. --config=path reads a configuration file
+    bool parseFlag(const std::string &arg) {
+        std::string key = arg.substr(2), value = "true";
+        size_t equals = key.find('=');
+        if (equals != std::string::npos) {
+            value = key.substr(equals + 1);
+            key.resize(equals);
+        } else if (key.rfind("no-", 0) == 0) {
+            key = key.substr(3);
+            value = "false";
+        }
+        if (key == "config" && equals != std::string::npos)
+            return readFile(value);
+        return set(key, value, "--" + key);
+    }
+
+    // one key = value per line, '#' starts a comment and blank lines are skipped
+    bool readFile(const std::string &path) {
+        std::ifstream in(path);
+        if (!in)
+            return fail("configuration file " + path + " could not be opened");
+        std::string line;
+        for (int number = 1; std::getline(in, line); ++number) {
+            line = trim(line.substr(0, line.find('#')));
+            if (line.empty())
+                continue;
+            std::string where = path + ":" + std::to_string(number);
+            size_t equals = line.find('=');
+            if (equals == std::string::npos)
+                return fail(where + ": expected key = value");
+            std::string key = trim(line.substr(0, equals));
+            if (key == "config")
+                return fail(where + ": configuration files cannot include others");
+            if (!set(key, trim(line.substr(equals + 1)), where))
+                return false;
+        }
+        return true;
+    }
+
+    bool set(const std::string &key, const std::string &value, const std::string &where) {
+        bool found = false;
+        for (auto &name : known)
+            found = found || name == key;
+        if (!found)
+            return fail(where + ": unknown setting '" + key + "'");
+        values[key] = value;
+        origin[key] = where;
+        return true;
+    }
+
+    bool has(const std::string &key) const { return values.count(key) != 0; }
+
+    // the getters leave value alone when the key is not set, and fail when it is set to something invalid
+    bool text(const std::string &key, std::string &value) const {
+        auto it = values.find(key);
+        if (it != values.end())
+            value = it->second;
+        return true;
+    }
+
+    bool choice(const std::string &key, std::string &value, std::initializer_list<const char *> allowed) {
+        auto it = values.find(key);
+        if (it == values.end())
+            return true;
+        std::string list;
+        for (const char *option : allowed) {
+            if (it->second == option) {
+                value = it->second;
+                return true;
+            }
+            list += std::string(list.empty() ? "" : ", ") + option;
+        }
+        return invalid(key, "one of " + list);
+    }
+
+    template <class Integer>
+    bool integer(const std::string &key, Integer &value, long long low, long long high) {
+        auto it = values.find(key);
+        if (it == values.end())
+            return true;
+        char *end;
+        long long parsed = std::strtoll(it->second.c_str(), &end, 0);
+        if (it->second.empty() || *end || parsed < low || parsed > high)
+            return invalid(key, "a whole number from " + std::to_string(low) + " to " + std::to_string(high));
+        value = Integer(parsed);
+        return true;
+    }
+
+    bool number(const std::string &key, double &value) {
+        auto it = values.find(key);
+        if (it == values.end())
+            return true;
+        char *end;
+        double parsed = std::strtod(it->second.c_str(), &end);
+        if (it->second.empty() || *end || !(parsed >= 0))
+            return invalid(key, "a number of at least 0");
+        value = parsed;
+        return true;
+    }
+
+    bool boolean(const std::string &key, bool &value) {
+        auto it = values.find(key);
+        if (it == values.end())
+            return true;
+        const std::string &v = it->second;
+        if (v == "true" || v == "yes" || v == "on" || v == "1")
+            value = true;
+        else if (v == "false" || v == "no" || v == "off" || v == "0")
+            value = false;
+        else
+            return invalid(key, "true or false");
+        return true;
+    }
+
+  private:
+    bool fail(const std::string &message) {
+        error = message;
+        return false;
+    }
+
+    bool invalid(const std::string &key, const std::string &expected) {
+        return fail(origin[key] + ": '" + values[key] + "' is not " + expected);
+    }
+
+    static std::string trim(const std::string &s) {
+        size_t start = s.find_first_not_of(" \t\r");
+        if (start == std::string::npos)
+            return "";
+        return s.substr(start, s.find_last_not_of(" \t\r") + 1 - start);
+    }
+};
+
+#endif
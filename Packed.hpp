@@ -0,0 +1,130 @@
+#ifndef __PACKED_HPP__
+#define __PACKED_HPP__
+
+#include <cstdint>
+#include <string_view>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// packed integer arithmetic on 32-bit registers after the MIPS DSP ASE: .qb treats a register as
+// four unsigned bytes and .ph as two halfwords, lane i holds bits 8i (or 16i) upwards.
+// the DSPControl overflow flag is not modelled
+namespace packed {
+
+enum Op {
+    ADDU_QB,
+    ADDU_S_QB,
+    SUBU_QB,
+    SUBU_S_QB,
+    ADDQ_PH,
+    ADDQ_S_PH,
+    SUBQ_PH,
+    SUBQ_S_PH,
+    ADDU_PH,
+    ADDU_S_PH,
+    SUBU_PH,
+    SUBU_S_PH,
+    MUL_PH,
+    MUL_S_PH,
+    NUM_OPS
+};
+
+const char *const names[NUM_OPS] = {
+    "addu.qb", "addu_s.qb", "subu.qb", "subu_s.qb", "addq.ph", "addq_s.ph", "subq.ph",
+    "subq_s.ph", "addu.ph", "addu_s.ph", "subu.ph", "subu_s.ph", "mul.ph", "mul_s.ph"};
+
+// NUM_OPS if the mnemonic is not a packed instruction
+inline Op fromName(std::string_view name) {
+    int i = 0;
+    while (i < NUM_OPS && name != names[i])
+        ++i;
+    return Op(i);
+}
+
+inline int clamp(int v, int lo, int hi) { return v < lo ? lo : v > hi ? hi : v; }
+
+// one lane at a time, the reference for the vector version and the fallback without SSE2
+inline int applyScalar(Op op, int a, int b) {
+    bool bytes = op <= SUBU_S_QB;
+    bool isSigned = op == ADDQ_PH || op == ADDQ_S_PH || op == SUBQ_PH || op == SUBQ_S_PH || op == MUL_PH || op == MUL_S_PH;
+    bool saturate = op == ADDU_S_QB || op == SUBU_S_QB || op == ADDQ_S_PH || op == SUBQ_S_PH ||
+                    op == ADDU_S_PH || op == SUBU_S_PH || op == MUL_S_PH;
+    int bits = bytes ? 8 : 16, lanes = 32 / bits;
+    uint32_t mask = (1u << bits) - 1, result = 0;
+    for (int i = 0; i < lanes; ++i) {
+        int x = (uint32_t(a) >> bits * i) & mask, y = (uint32_t(b) >> bits * i) & mask;
+        if (isSigned)
+            x = int16_t(x), y = int16_t(y);
+        int v;
+        if (op == ADDU_QB || op == ADDU_S_QB || op == ADDQ_PH || op == ADDQ_S_PH || op == ADDU_PH || op == ADDU_S_PH)
+            v = x + y;
+        else if (op == MUL_PH || op == MUL_S_PH)
+            v = x * y;
+        else
+            v = x - y;
+        if (saturate)
+            v = isSigned ? clamp(v, INT16_MIN, INT16_MAX) : clamp(v, 0, mask);
+        result |= (uint32_t(v) & mask) << bits * i;
+    }
+    return int(result);
+}
+
+// the register is moved into the low lanes of an SSE register so each operation is one instruction
+inline int apply(Op op, int a, int b) {
+#if defined(__SSE2__)
+    __m128i x = _mm_cvtsi32_si128(a), y = _mm_cvtsi32_si128(b), r;
+    switch (op) {
+    case ADDU_QB:
+        r = _mm_add_epi8(x, y);
+        break;
+    case ADDU_S_QB:
+        r = _mm_adds_epu8(x, y);
+        break;
+    case SUBU_QB:
+        r = _mm_sub_epi8(x, y);
+        break;
+    case SUBU_S_QB:
+        r = _mm_subs_epu8(x, y);
+        break;
+    case ADDQ_PH:
+    case ADDU_PH:
+        r = _mm_add_epi16(x, y);
+        break;
+    case ADDQ_S_PH:
+        r = _mm_adds_epi16(x, y);
+        break;
+    case ADDU_S_PH:
+        r = _mm_adds_epu16(x, y);
+        break;
+    case SUBQ_PH:
+    case SUBU_PH:
+        r = _mm_sub_epi16(x, y);
+        break;
+    case SUBQ_S_PH:
+        r = _mm_subs_epi16(x, y);
+        break;
+    case SUBU_S_PH:
+        r = _mm_subs_epu16(x, y);
+        break;
+    case MUL_PH:
+        r = _mm_mullo_epi16(x, y);
+        break;
+    case MUL_S_PH: {
+        // widen to the full 32-bit products and narrow again with signed saturation
+        __m128i products = _mm_unpacklo_epi16(_mm_mullo_epi16(x, y), _mm_mulhi_epi16(x, y));
+        r = _mm_packs_epi32(products, products);
+        break;
+    }
+    default:
+        return 0;
+    }
+    return _mm_cvtsi128_si32(r);
+#else
+    return applyScalar(op, a, b);
+#endif
+}
+
+} // namespace packed
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef __PERF_COUNTERS_HPP__
+#define __PERF_COUNTERS_HPP__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <ostream>
+#include <iomanip>
+#include "Program.hpp"
+
+// every counter of a run up to some cycle
+struct PerfSnapshot {
+    enum StallCause {
+        RAW = 0,       // a source is still being computed
+        LOAD_USE,      // a source is still being loaded
+        BRANCH,        // a branch or jr waits for its operands, branches resolve in decode
+        STRUCTURAL,    // a unit or port is busy
+        NUM_CAUSES
+    };
+    enum Stage {
+        IF = 0,
+        ID,
+        EX,
+        MEM,
+        WB,
+        NUM_STAGES
+    };
+
+    long long cycles = 0;
+    long long retired = 0;
+    // instructions that left decode, more than retired when the run stops with some in flight or a
+    // rewritten instruction is squashed and decoded again
+    long long issued = 0;
+    long long retiredByOpcode[NUM_OPCODES] = {0};
+    long long stallCycles[NUM_CAUSES] = {0};
+    // stall cycles charged to the register the stalled instruction waits for
+    long long stallCyclesByRegister[NUM_REGISTERS] = {0};
+    // cycles in which a stage did no useful work
+    long long bubbles[NUM_STAGES] = {0};
+    long long branches = 0;
+    long long branchesTaken = 0;
+    // branches decoded along a predicted direction that turned out wrong
+    long long branchMispredictions = 0;
+    long long jumps = 0;
+    long long memoryReads = 0;
+    long long memoryWrites = 0;
+
+    long long totalStallCycles() const {
+        long long total = 0;
+        for (long long s : stallCycles)
+            total += s;
+        return total;
+    }
+
+    double cpi() const { return retired ? double(cycles) / retired : 0.0; }
+};
+
+// per-run performance counters, sampled every sampleInterval cycles and exported as JSON or CSV. the
+// simulator bumps counters indexed by opcode and register, they are only named when written out
+struct PerfCounters : PerfSnapshot {
+    static constexpr const char *causeNames[NUM_CAUSES] = {"raw", "load_use", "branch", "structural"};
+    static constexpr const char *stageNames[NUM_STAGES] = {"IF", "ID", "EX", "MEM", "WB"};
+
+    // stages that did useful work in the current cycle, set by the stages themselves
+    bool busy[NUM_STAGES] = {false};
+    long long sampleInterval = 0;
+    std::vector<PerfSnapshot> samples;
+
+    void retire(Opcode opcode) {
+        ++retired;
+        ++retiredByOpcode[opcode];
+    }
+
+    // reg is -1 when the stall waits for no register in particular
+    void stall(StallCause cause, int reg) {
+        ++stallCycles[cause];
+        if (reg >= 0)
+            ++stallCyclesByRegister[reg];
+    }
+
+    void endCycle() {
+        ++cycles;
+        for (int s = 0; s < NUM_STAGES; ++s) {
+            bubbles[s] += !busy[s];
+            busy[s] = false;
+        }
+        if (sampleInterval > 0 && cycles % sampleInterval == 0)
+            samples.push_back(*this);
+    }
+
+    // the format follows the extension, .csv or JSON otherwise
+    bool write(const std::string &path) const {
+        std::ofstream out(path);
+        if (!out)
+            return false;
+        if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0)
+            writeCsv(out);
+        else
+            writeJson(out);
+        return bool(out);
+    }
+
+    // one row per sample and a last row for the end of the run, every counter is cumulative
+    void writeCsv(std::ostream &out) const {
+        out << "cycles,instructions,issued,cpi";
+        for (const char *cause : causeNames)
+            out << ",stall_" << cause;
+        for (const char *stage : stageNames)
+            out << ",bubbles_" << stage;
+        out << ",branches,branches_taken,branches_mispredicted,jumps,memory_reads,memory_writes";
+        std::map<std::string, int> opcodes = retiredOpcodes(), registers = stalledRegisters();
+        for (auto &op : opcodes)
+            out << ",retired_" << op.first;
+        for (auto &reg : registers)
+            out << ",stall_" << reg.first;
+        out << '\n';
+        std::vector<PerfSnapshot> rows = samples;
+        if (rows.empty() || rows.back().cycles != cycles)
+            rows.push_back(*this);
+        for (auto &row : rows) {
+            out << row.cycles << ',' << row.retired << ',' << row.issued << ',' << std::fixed << std::setprecision(3) << row.cpi();
+            for (long long s : row.stallCycles)
+                out << ',' << s;
+            for (long long b : row.bubbles)
+                out << ',' << b;
+            out << ',' << row.branches << ',' << row.branchesTaken << ',' << row.branchMispredictions << ',' << row.jumps << ',' << row.memoryReads << ',' << row.memoryWrites;
+            for (auto &op : opcodes)
+                out << ',' << row.retiredByOpcode[op.second];
+            for (auto &reg : registers)
+                out << ',' << row.stallCyclesByRegister[reg.second];
+            out << '\n';
+        }
+    }
+
+    void writeJson(std::ostream &out) const {
+        out << "{\n";
+        out << "  \"cycles\": " << cycles << ",\n";
+        out << "  \"instructions\": " << retired << ",\n";
+        out << "  \"issued\": " << issued << ",\n";
+        out << "  \"cpi\": " << std::fixed << std::setprecision(3) << cpi() << ",\n";
+        out << "  \"retired_by_opcode\": ";
+        writeObject(out, retiredOpcodes(), retiredByOpcode);
+        out << ",\n  \"stall_cycles\": {";
+        for (int c = 0; c < NUM_CAUSES; ++c)
+            out << (c ? ", " : "") << '"' << causeNames[c] << "\": " << stallCycles[c];
+        out << "},\n  \"stall_cycles_by_register\": ";
+        writeObject(out, stalledRegisters(), stallCyclesByRegister);
+        out << ",\n  \"bubbles\": {";
+        for (int s = 0; s < NUM_STAGES; ++s)
+            out << (s ? ", " : "") << '"' << stageNames[s] << "\": " << bubbles[s];
+        out << "},\n";
+        out << "  \"branches\": {\"total\": " << branches << ", \"taken\": " << branchesTaken << ", \"mispredicted\": " << branchMispredictions << "},\n";
+        out << "  \"jumps\": " << jumps << ",\n";
+        out << "  \"memory\": {\"reads\": " << memoryReads << ", \"writes\": " << memoryWrites << "},\n";
+        out << "  \"samples\": [";
+        for (size_t i = 0; i < samples.size(); ++i) {
+            const PerfSnapshot &s = samples[i];
+            out << (i ? ",\n    " : "\n    ") << "{\"cycles\": " << s.cycles << ", \"instructions\": " << s.retired
+                << ", \"cpi\": " << s.cpi() << ", \"stall_cycles\": " << s.totalStallCycles() << ", \"branches\": " << s.branches
+                << ", \"memory_reads\": " << s.memoryReads << ", \"memory_writes\": " << s.memoryWrites << '}';
+        }
+        out << (samples.empty() ? "]\n" : "\n  ]\n") << "}\n";
+    }
+
+  private:
+    // the opcodes that retired and the registers waited for by the end of the run, sorted by name
+    // for the columns and keys of the export
+    std::map<std::string, int> retiredOpcodes() const {
+        std::map<std::string, int> names;
+        for (int op = 0; op < NUM_OPCODES; ++op)
+            if (retiredByOpcode[op])
+                names[opcodeName(Opcode(op))] = op;
+        return names;
+    }
+
+    std::map<std::string, int> stalledRegisters() const {
+        std::map<std::string, int> names;
+        for (int reg = 0; reg < NUM_REGISTERS; ++reg)
+            if (stallCyclesByRegister[reg])
+                names[Program::registerName(reg)] = reg;
+        return names;
+    }
+
+    // keys are opcodes and register names, neither needs escaping
+    static void writeObject(std::ostream &out, const std::map<std::string, int> &names, const long long *counts) {
+        out << '{';
+        bool first = true;
+        for (auto &p : names) {
+            out << (first ? "" : ", ") << '"' << p.first << "\": " << counts[p.second];
+            first = false;
+        }
+        out << '}';
+    }
+};
+
+#endif
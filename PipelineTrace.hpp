@@ -0,0 +1,143 @@
+#ifndef __PIPELINE_TRACE_HPP__
+#define __PIPELINE_TRACE_HPP__
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// per-instruction lifecycle log in the Kanata format read by the Konata pipeline viewer.
+// every call returns at once unless a file was opened, and the log is written in large blocks
+struct PipelineTrace {
+    static const size_t BLOCK = 1 << 16;
+    // instructions in flight at once are far fewer than this
+    static const int SLOTS = 16;
+
+    bool enabled = false;
+    FILE *file = nullptr;
+    std::string buffer;
+    long long pendingCycles = 0;
+    long long nextId = 0;
+    long long retired = 0;
+    long long lastRetired = -1;
+    std::vector<long long> retiring;
+    // latest stage of the instruction holding each slot, stages only move forward
+    long long slotId[SLOTS];
+    int slotStage[SLOTS];
+
+    PipelineTrace() {
+        for (int i = 0; i < SLOTS; ++i)
+            slotId[i] = -1, slotStage[i] = -1;
+    }
+    PipelineTrace(const PipelineTrace &) = delete;
+    PipelineTrace &operator=(const PipelineTrace &) = delete;
+    ~PipelineTrace() { close(); }
+
+    bool open(const std::string &path) {
+        file = fopen(path.c_str(), "w");
+        if (!file)
+            return false;
+        enabled = true;
+        buffer.reserve(2 * BLOCK);
+        buffer += "Kanata\t0004\nC=\t0\n";
+        return true;
+    }
+
+    void close() {
+        if (!enabled)
+            return;
+        cycle();
+        advance();
+        flush();
+        fclose(file);
+        enabled = false;
+    }
+
+    // called once at the start of every simulated cycle
+    void cycle() {
+        if (!enabled)
+            return;
+        ++pendingCycles;
+        // an instruction leaves the pipeline the cycle after writeback
+        if (!retiring.empty()) {
+            advance();
+            for (long long id : retiring)
+                line("R", id, retired++, "0");
+            lastRetired = retiring.back();
+            retiring.clear();
+        }
+    }
+
+    // a new instruction enters fetch, returns its id
+    long long fetch(int pc, const std::string &text) {
+        if (!enabled)
+            return -1;
+        long long id = nextId++;
+        advance();
+        line("I", id, id, "0");
+        line("L", id, 0, std::to_string(pc) + ": " + text);
+        slotId[id % SLOTS] = id;
+        slotStage[id % SLOTS] = -1;
+        stage(id, 0, "F");
+        return id;
+    }
+
+    // the instruction is in stage index (0 fetch ... 4 writeback) named name this cycle
+    void stage(long long id, int index, const char *name) {
+        if (!enabled || id < 0 || slotId[id % SLOTS] != id || slotStage[id % SLOTS] >= index)
+            return;
+        slotStage[id % SLOTS] = index;
+        advance();
+        line("S", id, 0, name);
+    }
+
+    // extra text shown when hovering over the instruction
+    void note(long long id, const std::string &text) {
+        if (!enabled || id < 0)
+            return;
+        advance();
+        line("L", id, 1, text);
+    }
+
+    // the instruction leaves the pipeline without retiring
+    void squash(long long id) {
+        if (!enabled || id < 0 || slotId[id % SLOTS] != id)
+            return;
+        slotId[id % SLOTS] = -1;
+        advance();
+        line("R", id, id, "1");
+    }
+
+    void retire(long long id) {
+        if (!enabled || id <= lastRetired || (!retiring.empty() && id <= retiring.back()))
+            return;
+        retiring.push_back(id);
+    }
+
+  private:
+    void advance() {
+        if (pendingCycles == 0)
+            return;
+        buffer += "C\t" + std::to_string(pendingCycles) + '\n';
+        pendingCycles = 0;
+    }
+
+    void line(const char *command, long long id, long long field, const std::string &last) {
+        buffer += command;
+        buffer += '\t';
+        buffer += std::to_string(id);
+        buffer += '\t';
+        buffer += std::to_string(field);
+        buffer += '\t';
+        buffer += last;
+        buffer += '\n';
+        if (buffer.size() >= BLOCK)
+            flush();
+    }
+
+    void flush() {
+        fwrite(buffer.data(), 1, buffer.size(), file);
+        buffer.clear();
+    }
+};
+
+#endif
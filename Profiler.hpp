@@ -0,0 +1,97 @@
+#ifndef __PROFILER_HPP__
+#define __PROFILER_HPP__
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <map>
+#include <algorithm>
+#include <fstream>
+#include <ostream>
+#include <iomanip>
+#include <iterator>
+
+// cycles attributed to every instruction of the simulated program
+struct Profiler {
+    struct Counts {
+        long long executed = 0;
+        long long stallCycles = 0;
+        long long taken = 0;
+        long long mispredicted = 0;
+
+        // the issue cycle of every execution plus the cycles spent waiting in decode
+        long long cycles() const { return executed + stallCycles; }
+    };
+
+    std::vector<Counts> counts;
+
+    void resize(size_t instructions) { counts.assign(instructions, Counts()); }
+
+    // text[pc] is the source of instruction pc and lineOf[pc] its line, labels map to the pc they mark
+    bool write(const std::string &path, const std::vector<std::string> &text, const std::vector<int> &lineOf,
+               const std::unordered_map<std::string, int> &labels, long long totalCycles) const {
+        std::ofstream out(path);
+        if (!out)
+            return false;
+        write(out, text, lineOf, labels, totalCycles);
+        return bool(out);
+    }
+
+    void write(std::ostream &out, const std::vector<std::string> &text, const std::vector<int> &lineOf,
+               const std::unordered_map<std::string, int> &labels, long long totalCycles) const {
+        // every pc belongs to the closest label at or before it
+        std::map<int, std::string> starts;
+        for (auto &label : labels)
+            if (label.second >= 0 && label.second < (int)counts.size() && (!starts.count(label.second) || label.first < starts[label.second]))
+                starts[label.second] = label.first;
+        std::vector<std::string> owner(counts.size());
+        std::vector<int> offset(counts.size(), 0);
+        std::string current;
+        for (int pc = 0, start = 0; pc < (int)counts.size(); ++pc) {
+            auto it = starts.find(pc);
+            if (it != starts.end())
+                current = it->second, start = pc;
+            owner[pc] = current;
+            offset[pc] = pc - start;
+        }
+
+        std::vector<int> order(counts.size());
+        for (int pc = 0; pc < (int)order.size(); ++pc)
+            order[pc] = pc;
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return counts[a].cycles() > counts[b].cycles(); });
+
+        out << "Total cycles: " << totalCycles << "\n\n";
+        out << std::setw(10) << "cycles" << std::setw(8) << "%" << std::setw(10) << "executed" << std::setw(10) << "stalls"
+            << std::setw(8) << "taken" << std::setw(8) << "mispred" << std::setw(7) << "line" << std::setw(6) << "pc" << "  " << std::left << std::setw(16) << "location" << std::right << "instruction\n";
+        for (int pc : order) {
+            const Counts &c = counts[pc];
+            out << std::setw(10) << c.cycles() << std::setw(8) << std::fixed << std::setprecision(2) << percent(c.cycles(), totalCycles)
+                << std::setw(10) << c.executed << std::setw(10) << c.stallCycles << std::setw(8) << c.taken << std::setw(8) << c.mispredicted
+                << std::setw(7) << lineOf[pc] << std::setw(6) << pc << "  " << std::left << std::setw(16) << location(owner[pc], offset[pc]) << std::right << text[pc] << '\n';
+        }
+
+        // labels in program order, each covering the instructions up to the next one
+        out << '\n' << std::setw(10) << "cycles" << std::setw(8) << "%" << std::setw(10) << "executed" << std::setw(10) << "stalls" << "  label\n";
+        for (auto it = starts.begin(); it != starts.end(); ++it) {
+            int end = std::next(it) == starts.end() ? counts.size() : std::next(it)->first;
+            Counts total;
+            for (int pc = it->first; pc < end; ++pc) {
+                total.executed += counts[pc].executed;
+                total.stallCycles += counts[pc].stallCycles;
+            }
+            out << std::setw(10) << total.cycles() << std::setw(8) << percent(total.cycles(), totalCycles) << std::setw(10) << total.executed
+                << std::setw(10) << total.stallCycles << "  " << it->second << '\n';
+        }
+    }
+
+  private:
+    static double percent(long long part, long long whole) { return whole ? 100.0 * part / whole : 0.0; }
+
+    static std::string location(const std::string &label, int offset) {
+        if (label.empty())
+            return "-";
+        return offset ? label + "+" + std::to_string(offset) : label;
+    }
+};
+
+#endif
@@ -0,0 +1,559 @@
+#ifndef __PROGRAM_HPP__
+#define __PROGRAM_HPP__
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <type_traits>
+#include "Assembler.hpp"
+#include "Instruction.hpp"
+#include "Elf.hpp"
+#include "StateHash.hpp"
+
+static_assert(std::is_trivially_copyable<Instruction>::value, "instructions are stored verbatim in program images");
+
+// header of a pre-assembled program image, followed by the instructions and then the
+// initial data segment as (word index, value) pairs
+struct ImageHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t instructionSize;
+    uint32_t instructions;
+    uint32_t dataWords;
+    uint32_t base;
+    int32_t entry;
+    int32_t bigEndian;
+    int32_t registers[32];
+};
+
+struct Program : Assembler {
+    static const int MAX = (1 << 20);
+    enum exit_code {
+        SUCCESS = 0,
+        INVALID_REGISTER,
+        INVALID_LABEL,
+        INVALID_ADDRESS,
+        SYNTAX_ERROR,
+        MEMORY_ERROR
+    };
+
+    static constexpr char IMAGE_MAGIC[4] = {'M', 'I', 'P', 'O'};
+    static const uint32_t IMAGE_VERSION = 3;
+
+    MappedFile source;
+    std::vector<Instruction> code;
+    // words of data memory that start out non-zero
+    std::vector<std::pair<int32_t, int32_t>> initialData;
+    // address of instruction 0, memory word i is at base + 4 * i
+    uint32_t base = 0;
+    int entry = 0;
+    // byte order of sub-word memory accesses, text programs use the order the ELF writer emits
+    bool bigEndian = true;
+    int initialRegisters[32] = {0};
+    int exitcode = SUCCESS;
+    int errorPC = -1;
+
+    static const std::unordered_map<std::string, int> &registerMap() {
+        static std::unordered_map<std::string, int> registerMap;
+        if (registerMap.empty()) {
+            for (int i = 0; i < 32; ++i)
+                registerMap["$" + std::to_string(i)] = i;
+            registerMap["$zero"] = 0;
+            registerMap["$at"] = 1;
+            registerMap["$v0"] = 2;
+            registerMap["$v1"] = 3;
+            for (int i = 0; i < 4; ++i)
+                registerMap["$a" + std::to_string(i)] = i + 4;
+            for (int i = 0; i < 8; ++i)
+                registerMap["$t" + std::to_string(i)] = i + 8, registerMap["$s" + std::to_string(i)] = i + 16;
+            registerMap["$t8"] = 24;
+            registerMap["$t9"] = 25;
+            registerMap["$k0"] = 26;
+            registerMap["$k1"] = 27;
+            registerMap["$gp"] = 28;
+            registerMap["$sp"] = 29;
+            registerMap["$s8"] = 30;
+            registerMap["$ra"] = 31;
+            registerMap["$hi"] = REG_HI;
+            registerMap["$lo"] = REG_LO;
+        }
+        return registerMap;
+    }
+
+    // maps, assembles and decodes the whole file, or takes a pre-assembled image as is,
+    // returns false only if it cannot be opened, errors are left in exitcode and errorPC
+    bool load(const char *path) {
+        if (!source.load(path))
+            return false;
+        if (isImage(source.view()))
+            loadImage(source.view());
+        else if (isElf(source.view()))
+            loadElf(source.view());
+        else
+            assemble(source.view());
+        return true;
+    }
+
+    static bool isImage(std::string_view file) {
+        return file.size() >= sizeof(ImageHeader) && memcmp(file.data(), IMAGE_MAGIC, 4) == 0;
+    }
+
+    static bool isElf(std::string_view file) {
+        return file.size() >= 4 && memcmp(file.data(), "\x7f" "ELF", 4) == 0;
+    }
+
+    // static MIPS32 executables, the stack starts at the top of simulated memory and
+    // returning from the entry point falls off the end of the code
+    bool loadElf(std::string_view file) {
+        ElfProgram elfProgram;
+        if (!elf::load(file, MAX, elfProgram)) {
+            std::cerr << "ELF: " << elfProgram.error << '\n';
+            exitcode = SYNTAX_ERROR;
+            errorPC = elfProgram.errorIndex;
+            return false;
+        }
+        code = std::move(elfProgram.code);
+        initialData = std::move(elfProgram.data);
+        base = elfProgram.base;
+        entry = elfProgram.entry;
+        bigEndian = elfProgram.bigEndian;
+        initialRegisters[29] = base + MAX - 16;
+        initialRegisters[31] = base + 4 * code.size();
+        return true;
+    }
+
+    bool writeElf(const char *path) const {
+        std::string error;
+        if (!elf::write(path, code, initialData, base, entry, bigEndian, error)) {
+            std::cerr << "ELF: " << error << '\n';
+            return false;
+        }
+        return true;
+    }
+
+    // the image holds the decoded instructions with resolved targets, so loading is a bounds check and a copy
+    bool loadImage(std::string_view image) {
+        ImageHeader header;
+        memcpy(&header, image.data(), sizeof header);
+        size_t expected = sizeof header + (size_t)header.instructions * sizeof(Instruction) + (size_t)header.dataWords * 2 * sizeof(int32_t);
+        if (header.version != IMAGE_VERSION || header.instructionSize != sizeof(Instruction) || image.size() != expected) {
+            exitcode = SYNTAX_ERROR;
+            return false;
+        }
+        const char *p = image.data() + sizeof header;
+        code.resize(header.instructions);
+        memcpy(code.data(), p, header.instructions * sizeof(Instruction));
+        p += header.instructions * sizeof(Instruction);
+        // std::pair is not trivially copyable, each (index, value) is read on its own
+        initialData.resize(header.dataWords);
+        for (auto &word : initialData) {
+            int32_t pair[2];
+            memcpy(pair, p, sizeof pair);
+            p += sizeof pair;
+            word = {pair[0], pair[1]};
+        }
+        base = header.base;
+        entry = header.entry;
+        bigEndian = header.bigEndian != 0;
+        memcpy(initialRegisters, header.registers, sizeof initialRegisters);
+        if (code.size() >= MAX / 4) {
+            exitcode = MEMORY_ERROR;
+            return false;
+        }
+        auto badRegister = [](int r)
+        { return r < 0 || r >= NUM_REGISTERS; };
+        // shift amounts are checked like the assembler does, a shift by 32 or more is undefined
+        auto badShift = [](const Instruction &inst)
+        { return (inst.opcode == OP_SLL || inst.opcode == OP_SRL || inst.opcode == OP_SRA) && (inst.imm < 0 || inst.imm > 31); };
+        for (auto &inst : code)
+            if (inst.opcode < 0 || inst.opcode >= NUM_OPCODES || inst.target < 0 || inst.target > (int)code.size() ||
+                badRegister(inst.rd) || badRegister(inst.rs) || badRegister(inst.rt) || badShift(inst)) {
+                exitcode = SYNTAX_ERROR;
+                return false;
+            }
+        if (entry < 0 || entry > (int)code.size()) {
+            exitcode = SYNTAX_ERROR;
+            return false;
+        }
+        for (auto &word : initialData)
+            if (word.first < 0 || word.first >= MAX / 4) {
+                exitcode = MEMORY_ERROR;
+                return false;
+            }
+        return true;
+    }
+
+    // write the decoded program so later runs can skip the assembler
+    bool writeImage(const char *path) const {
+        FILE *out = fopen(path, "wb");
+        if (!out)
+            return false;
+        ImageHeader header;
+        memcpy(header.magic, IMAGE_MAGIC, 4);
+        header.version = IMAGE_VERSION;
+        header.instructionSize = sizeof(Instruction);
+        header.instructions = code.size();
+        header.dataWords = initialData.size();
+        header.base = base;
+        header.entry = entry;
+        header.bigEndian = bigEndian;
+        memcpy(header.registers, initialRegisters, sizeof initialRegisters);
+        std::vector<int32_t> data;
+        data.reserve(2 * initialData.size());
+        for (auto &word : initialData)
+            data.push_back(word.first), data.push_back(word.second);
+        bool ok = fwrite(&header, sizeof header, 1, out) == 1 &&
+                  fwrite(code.data(), sizeof(Instruction), code.size(), out) == code.size() &&
+                  fwrite(data.data(), sizeof(int32_t), data.size(), out) == data.size();
+        return fclose(out) == 0 && ok;
+    }
+
+    // decodes each instruction as soon as the assembler emits it, branch targets are patched
+    // once every label is known so forward references need no second pass over the text
+    bool assemble(std::string_view text) {
+        std::vector<std::pair<int, std::string_view>> fixups;
+        parse(text, [&](const Tokens &command)
+              {
+            int pc = code.size();
+            code.emplace_back();
+            Instruction &inst = code.back();
+            int status = decodeCommand(command, inst);
+            if (status != SUCCESS)
+                fail(status, pc);
+            else if (inst.isBranch())
+                fixups.emplace_back(pc, command[3]);
+            else if (inst.opcode == OP_J || inst.opcode == OP_JAL)
+                fixups.emplace_back(pc, command[1]);
+            if (inst.opcode == OP_JAL)
+                inst.imm = base + 4 * (pc + 1); });
+        if (commands.size() >= MAX / 4) {
+            exitcode = MEMORY_ERROR;
+            errorPC = -1;
+            return false;
+        }
+        for (auto &f : fixups) {
+            int target = decodeLabel(f.second);
+            if (target < 0)
+                fail(-target, f.first);
+            else
+                code[f.first].target = target;
+        }
+        return exitcode == SUCCESS;
+    }
+
+    // keeps the error of the earliest instruction
+    void fail(int code, int pc) {
+        if (exitcode == SUCCESS || pc < errorPC)
+            exitcode = code, errorPC = pc;
+    }
+
+    // checks if label is valid
+    static bool checkLabel(std::string_view str) {
+        return str.size() > 0 && isalpha(str[0]) && std::all_of(str.begin() + 1, str.end(), [](char c)
+                                                                { return (bool)isalnum(c); }) &&
+               decodeOpcode(str) == NUM_OPCODES;
+    }
+
+    static Opcode decodeOpcode(std::string_view s) {
+        static const std::unordered_map<std::string_view, Opcode> opcodes(opcodeMap().begin(), opcodeMap().end());
+        auto it = opcodes.find(s);
+        return it == opcodes.end() ? NUM_OPCODES : it->second;
+    }
+
+    // resolves a register name, -1 if invalid
+    static int decodeRegister(std::string_view r) {
+        static const std::unordered_map<std::string_view, int> registers(registerMap().begin(), registerMap().end());
+        auto it = registers.find(r);
+        return it == registers.end() ? -1 : it->second;
+    }
+
+    // conventional name of a register index
+    static const char *registerName(int r) {
+        static const char *const names[NUM_REGISTERS] = {"$zero", "$at", "$v0", "$v1", "$a0", "$a1", "$a2", "$a3", "$t0", "$t1", "$t2", "$t3",
+                                                         "$t4", "$t5", "$t6", "$t7", "$s0", "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7",
+                                                         "$t8", "$t9", "$k0", "$k1", "$gp", "$sp", "$s8", "$ra", "$hi", "$lo"};
+        return names[r];
+    }
+
+    // resolves a label to its target, or a negative exit code
+    int decodeLabel(std::string_view label) const {
+        if (!checkLabel(label))
+            return -SYNTAX_ERROR;
+        auto it = address.find(label);
+        if (it == address.end() || it->second == -1)
+            return -INVALID_LABEL;
+        return it->second;
+    }
+
+    // why decodeCommand rejected a command: the exit code, the token at fault (0 for the opcode) and what is wrong with it
+    struct DecodeError {
+        int code = SUCCESS;
+        int operand = 0;
+        std::string reason;
+    };
+
+    // decodes the operands of a command left to right, stopping at the first bad one
+    struct Operands {
+        const Tokens &command;
+        DecodeError *error;
+        int status = SUCCESS;
+
+        Operands(const Tokens &command, DecodeError *error) : command(command), error(error) {}
+
+        Operands &fail(int code, int k, const std::string &reason) {
+            status = code;
+            if (error)
+                *error = DecodeError{code, k, reason};
+            return *this;
+        }
+
+        std::string quoted(int k) const { return "'" + std::string(command[k]) + "'"; }
+
+        // a written register cannot be $zero
+        Operands &reg(int k, int &r, bool written = false) {
+            if (status != SUCCESS)
+                return *this;
+            r = decodeRegister(command[k]);
+            if (r < 0)
+                return fail(INVALID_REGISTER, k, command[k].empty() ? "missing register operand" : quoted(k) + " is not a register");
+            if (written && r == 0)
+                return fail(INVALID_REGISTER, k, quoted(k) + " cannot be written");
+            return *this;
+        }
+
+        Operands &immediate(int k, int &value, int low = INT_MIN, int high = INT_MAX) {
+            if (status != SUCCESS)
+                return *this;
+            if (!parseInt(command[k], value))
+                return fail(SYNTAX_ERROR, k, command[k].empty() ? "missing immediate operand" : quoted(k) + " is not an integer");
+            if (value < low || value > high)
+                return fail(SYNTAX_ERROR, k, quoted(k) + " is outside " + std::to_string(low) + " to " + std::to_string(high));
+            return *this;
+        }
+
+        // only checked here, the target is resolved once every label is known
+        Operands &label(int k) {
+            if (status == SUCCESS && !checkLabel(command[k]))
+                return fail(SYNTAX_ERROR, k, command[k].empty() ? "missing label operand" : quoted(k) + " is not a valid label");
+            return *this;
+        }
+
+        // splits "offset(reg)", "(reg)" or an absolute address into base register and offset
+        Operands &location(int k, Instruction &inst) {
+            if (status != SUCCESS)
+                return *this;
+            std::string_view location = command[k];
+            size_t lparen = location.find('(');
+            if (location.empty() || (location.back() == ')' && lparen == std::string_view::npos))
+                return fail(SYNTAX_ERROR, k, location.empty() ? "missing address operand" : quoted(k) + " is not an address or offset(register)");
+            if (location.back() != ')') {
+                inst.rs = 0;
+                return parseInt(location, inst.imm) ? *this : fail(SYNTAX_ERROR, k, quoted(k) + " is not an address or offset(register)");
+            }
+            inst.imm = 0;
+            if (lparen > 0 && !parseInt(location.substr(0, lparen), inst.imm))
+                return fail(SYNTAX_ERROR, k, quoted(k) + " is not an address or offset(register)");
+            std::string_view base = location.substr(lparen + 1, location.size() - lparen - 2);
+            inst.rs = decodeRegister(base);
+            return inst.rs < 0 ? fail(INVALID_ADDRESS, k, "'" + std::string(base) + "' is not a register") : *this;
+        }
+    };
+
+    // decodes everything but branch targets, which are resolved by assemble. returns the exit code
+    // of the first bad operand, which error describes when given
+    static int decodeCommand(const Tokens &command, Instruction &inst, DecodeError *error = nullptr) {
+        Operands operands(command, error);
+        inst.opcode = decodeOpcode(command[0]);
+        switch (inst.opcode) {
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_SLT:
+        case OP_AND:
+        case OP_OR:
+        case OP_XOR:
+        case OP_NOR:
+            return operands.reg(1, inst.rd, true).reg(2, inst.rs).reg(3, inst.rt).status;
+        case OP_ADDI:
+        case OP_ANDI:
+        case OP_ORI:
+        case OP_SLTI:
+            return operands.reg(1, inst.rd, true).reg(2, inst.rs).immediate(3, inst.imm).status;
+        case OP_SLL:
+        case OP_SRL:
+        case OP_SRA:
+            return operands.reg(1, inst.rd, true).reg(2, inst.rs).immediate(3, inst.imm, 0, 31).status;
+        case OP_LUI:
+            return operands.reg(1, inst.rd, true).immediate(2, inst.imm).status;
+        case OP_BEQ:
+        case OP_BNE:
+            return operands.reg(1, inst.rs).reg(2, inst.rt).label(3).status;
+        case OP_J:
+            return operands.label(1).status;
+        case OP_JAL:
+            inst.rd = 31;
+            return operands.label(1).status;
+        case OP_JR:
+            return operands.reg(1, inst.rs).status;
+        case OP_DIV:
+            inst.rd = REG_LO;
+            return operands.reg(1, inst.rs).reg(2, inst.rt).status;
+        case OP_MFHI:
+        case OP_MFLO:
+            inst.rs = inst.opcode == OP_MFHI ? REG_HI : REG_LO;
+            return operands.reg(1, inst.rd, true).status;
+        case OP_LW:
+        case OP_LB:
+        case OP_LBU:
+        case OP_LH:
+        case OP_LHU:
+            return operands.reg(1, inst.rd, true).location(2, inst).status;
+        case OP_SW:
+        case OP_SB:
+        case OP_SH:
+            return operands.reg(1, inst.rt).location(2, inst).status;
+        default:
+            // packed instructions take three registers like add
+            if (inst.isPacked())
+                return operands.reg(1, inst.rd, true).reg(2, inst.rs).reg(3, inst.rt).status;
+            return operands.fail(SYNTAX_ERROR, 0, "unknown instruction '" + std::string(command[0]) + "'").status;
+        }
+    }
+
+    // converts a byte address into the index of the data word holding it, -1 if it is not
+    // aligned to the access size or out of range
+    int wordIndex(int byteAddress, int size = 4) const {
+        uint32_t offset = uint32_t(byteAddress) - base;
+        if (offset % size || offset < 4 * code.size() || offset >= MAX)
+            return -1;
+        return offset / 4;
+    }
+
+    // byte within its data word of an address accepted by wordIndex
+    int byteOffset(int byteAddress) const {
+        return (uint32_t(byteAddress) - base) % 4;
+    }
+
+    // converts a code address into an instruction index, the end of the code is allowed
+    // since falling off it terminates the program, -1 otherwise
+    int codeIndex(int byteAddress) const {
+        uint32_t offset = uint32_t(byteAddress) - base;
+        if (offset % 4 || offset > 4 * code.size())
+            return -1;
+        return offset / 4;
+    }
+
+    // index of the instruction executed after inst given its operand values,
+    // -1 if jr leaves the code
+    int nextPC(const Instruction &inst, int pc, int a, int b) const {
+        switch (inst.opcode) {
+        case OP_J:
+        case OP_JAL:
+            return inst.target;
+        case OP_JR:
+            return codeIndex(a);
+        case OP_BEQ:
+        case OP_BNE:
+            return branchTaken(inst, a, b) ? inst.target : pc + 1;
+        default:
+            return pc + 1;
+        }
+    }
+
+    /*
+        print the error for an exit code:
+        0: correct execution
+        1: register provided is incorrect
+        2: invalid label
+        3: unaligned or invalid address
+        4: syntax error
+        5: commands exceed memory limit
+    */
+    void handleExit(int code, int pc) const {
+        std::cout << '\n';
+        printExitMessage(code);
+        if (code != 0 && pc >= 0 && pc < (int)commands.size()) {
+            std::cerr << "Error encountered at:\n";
+            for (auto &s : commands[pc])
+                std::cerr << s << ' ';
+            std::cerr << '\n';
+        }
+        // images carry no source text
+        else if (code != 0 && pc >= 0)
+            std::cerr << "Error encountered at instruction " << pc << '\n';
+    }
+
+    // the message for an exit code on standard error, nothing for success
+    static void printExitMessage(int code) {
+        switch (code) {
+        case 1:
+            std::cerr << "Invalid register provided or syntax error in providing register\n";
+            break;
+        case 2:
+            std::cerr << "Label used not defined or defined too many times\n";
+            break;
+        case 3:
+            std::cerr << "Unaligned or invalid memory address specified\n";
+            break;
+        case 4:
+            std::cerr << "Syntax error encountered\n";
+            break;
+        case 5:
+            std::cerr << "Memory limit exceeded\n";
+            break;
+        default:
+            break;
+        }
+    }
+};
+
+// architectural state shared by the decoded-stream models
+struct ArchState {
+    int registers[NUM_REGISTERS] = {0};
+    std::vector<int> data;
+    MemoryDelta memoryDelta;
+
+    ArchState() : data(Program::MAX >> 2, 0), memoryDelta(Program::MAX >> 2) {}
+
+    void initialise(const Program &program) {
+        std::copy(program.initialRegisters, program.initialRegisters + 32, registers);
+        for (auto &word : program.initialData)
+            data[word.first] = word.second;
+    }
+
+    void store(int index, int value) {
+        if (data[index] != value)
+            memoryDelta.insert(index);
+        data[index] = value;
+    }
+
+    // print the register data and the memory written since the last call
+    void printRegistersAndMemoryDelta() {
+        for (int i = 0; i < 32; ++i)
+            std::cout << registers[i] << ' ';
+        std::cout << '\n';
+        std::cout << memoryDelta.size() << (memoryDelta.empty() ? '\n' : ' ');
+        for (int index : memoryDelta)
+            std::cout << index << ' ' << data[index] << '\n';
+        memoryDelta.clear();
+    }
+
+    // print the state of cycles in which nothing was written
+    void printUnchanged(long long cycles) {
+        std::string line;
+        for (int i = 0; i < 32; ++i)
+            line += std::to_string(registers[i]) + ' ';
+        line += "\n0\n";
+        for (long long i = 0; i < cycles; ++i)
+            std::cout << line;
+    }
+};
+
+#endif
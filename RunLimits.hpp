@@ -0,0 +1,106 @@
+#ifndef __RUN_LIMITS_HPP__
+#define __RUN_LIMITS_HPP__
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <string>
+
+// how far a run may go before it is stopped, zero for no limit
+struct RunLimits {
+    long long maxCycles = 0;
+    long long maxInstructions = 0;
+    double maxSeconds = 0;
+    // stop a program once its architectural state repeats, it can only loop forever from there
+    bool watchdog = true;
+};
+
+// Brent's cycle detection over the state after each retirement: the pc retired and the state hash.
+// equal states run the same instructions again, so a repeat means the program never finishes, barring
+// a hash collision between different states. a loop is caught within about twice its period plus the
+// instructions before it, one comparison per step
+struct LoopWatchdog {
+    int savedPC = -1;
+    uint64_t savedHash = 0;
+    long long power = 1;
+    long long steps = 0;
+
+    bool repeats(int pc, uint64_t hash) {
+        if (pc == savedPC && hash == savedHash)
+            return true;
+        if (++steps == power) {
+            savedPC = pc;
+            savedHash = hash;
+            power *= 2;
+            steps = 0;
+        }
+        return false;
+    }
+
+    // state outside the hash is changing, start over
+    void reset() {
+        savedPC = -1;
+        power = 1;
+        steps = 0;
+    }
+};
+
+// how a run ended, the status is also the process exit status so scripts can tell the cases apart
+struct RunResult {
+    enum Status {
+        COMPLETED = 0,
+        CHECK_MISMATCH, // 1, as before
+        PROGRAM_ERROR,
+        CYCLE_LIMIT,
+        INSTRUCTION_LIMIT,
+        TIME_LIMIT,
+        LOOP,
+        SETUP_ERROR // bad settings or a file that could not be opened, nothing ran
+    };
+    static constexpr const char *statusNames[] = {"completed", "check_mismatch", "program_error", "cycle_limit", "instruction_limit", "time_limit", "loop", "setup_error"};
+
+    Status status = COMPLETED;
+    long long cycles = 0;
+    long long instructions = 0;
+    double seconds = 0;
+    // exit code of a program error, and the instruction the run stopped at
+    int code = 0;
+    int pc = -1;
+    std::string reason;
+
+    bool finished() const { return status == COMPLETED; }
+
+    static RunResult setupError(const std::string &reason) {
+        RunResult result;
+        result.status = SETUP_ERROR;
+        result.reason = reason;
+        return result;
+    }
+
+    // one JSON object, "-" writes it to standard error
+    bool write(const std::string &path) const {
+        if (path == "-") {
+            writeJson(std::cerr);
+            return true;
+        }
+        std::ofstream out(path);
+        if (!out)
+            return false;
+        writeJson(out);
+        return bool(out);
+    }
+
+    void writeJson(std::ostream &out) const {
+        out << "{\"status\": \"" << statusNames[status] << "\", \"cycles\": " << cycles << ", \"instructions\": " << instructions
+            << ", \"seconds\": " << seconds << ", \"code\": " << code << ", \"pc\": " << pc << ", \"reason\": \"";
+        for (char c : reason) {
+            if (c == '"' || c == '\\')
+                out << '\\';
+            out << c;
+        }
+        out << "\"}\n";
+    }
+};
+
+#endif
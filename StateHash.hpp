@@ -0,0 +1,60 @@
+#ifndef __STATE_HASH_HPP__
+#define __STATE_HASH_HPP__
+
+#include <cstdint>
+#include <vector>
+
+// running hash of an architectural state, the sum of a mix of every location with its value.
+// each write updates it in constant time. different hashes prove the states differ, while equal
+// hashes only make equal states very likely: two different states collide with odds near 2^-64
+struct StateHash {
+    // memory words are their own locations, registers are numbered from here
+    static const uint32_t REGISTERS = 0x80000000u;
+
+    uint64_t value = 0;
+
+    void update(uint32_t location, int before, int after) {
+        value += mix(location, after) - mix(location, before);
+    }
+
+    bool operator==(const StateHash &other) const { return value == other.value; }
+    bool operator!=(const StateHash &other) const { return value != other.value; }
+
+    // splitmix64 of the location and the value
+    static uint64_t mix(uint32_t location, int v) {
+        uint64_t x = (uint64_t(location) << 32 | uint32_t(v)) + 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+};
+
+// memory words written since the last clear, listed once each in the order they were first written.
+// a bitmap over all of memory finds repeats, clearing only visits the words listed
+struct MemoryDelta {
+    std::vector<int> words;
+    std::vector<uint64_t> marked;
+
+    explicit MemoryDelta(size_t memoryWords) : marked((memoryWords + 63) / 64, 0) { words.reserve(64); }
+
+    void insert(int word) {
+        uint64_t bit = 1ULL << (word & 63);
+        if (marked[word >> 6] & bit)
+            return;
+        marked[word >> 6] |= bit;
+        words.push_back(word);
+    }
+
+    void clear() {
+        for (int word : words)
+            marked[word >> 6] &= ~(1ULL << (word & 63));
+        words.clear();
+    }
+
+    size_t size() const { return words.size(); }
+    bool empty() const { return words.empty(); }
+    std::vector<int>::const_iterator begin() const { return words.begin(); }
+    std::vector<int>::const_iterator end() const { return words.end(); }
+};
+
+#endif
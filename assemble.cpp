@@ -0,0 +1,32 @@
+#include <iostream>
+#include "Program.hpp"
+
+// assembles a program once into an image that every simulator loads without parsing,
+// or into a MIPS32 ELF executable when the output name ends in .elf
+int main(int argc, char *argv[])
+{
+	if (argc != 3)
+	{
+		std::cerr << "Required arguments: input_file output_file\n./assemble <file name> <image name | executable.elf>\n";
+		return 0;
+	}
+	std::string output = argv[2];
+	bool elf = output.size() > 4 && output.compare(output.size() - 4, 4, ".elf") == 0;
+	Program program;
+	if (!program.load(argv[1]))
+	{
+		std::cerr << "File could not be opened. Terminating...\n";
+		return 1;
+	}
+	if (program.exitcode)
+	{
+		program.handleExit(program.exitcode, program.errorPC);
+		return 1;
+	}
+	if (elf ? !program.writeElf(argv[2]) : !program.writeImage(argv[2]))
+	{
+		std::cerr << "Image could not be written. Terminating...\n";
+		return 1;
+	}
+	return 0;
+}
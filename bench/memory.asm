@@ -0,0 +1,37 @@
+# memory-heavy workload for make bench: fills an array, then repeatedly copies it to a second
+# array while summing it, four words per iteration, so most instructions are loads and stores
+	addi $s0, $zero, 4096
+	addi $s1, $zero, 8192
+	addi $s2, $zero, 256
+	addi $t0, $zero, 0
+fill:
+	sll $t1, $t0, 2
+	add $t1, $t1, $s0
+	sw $t0, 0($t1)
+	addi $t0, $t0, 1
+	bne $t0, $s2, fill
+	addi $s3, $zero, 100
+pass:
+	add $t1, $zero, $s0
+	add $t2, $zero, $s1
+	addi $t0, $zero, 0
+copy:
+	lw $t3, 0($t1)
+	lw $t4, 4($t1)
+	lw $t5, 8($t1)
+	lw $t6, 12($t1)
+	sw $t3, 0($t2)
+	sw $t4, 4($t2)
+	sw $t5, 8($t2)
+	sw $t6, 12($t2)
+	add $s4, $s4, $t3
+	add $s4, $s4, $t4
+	add $s4, $s4, $t5
+	add $s4, $s4, $t6
+	addi $t1, $t1, 16
+	addi $t2, $t2, 16
+	addi $t0, $t0, 4
+	bne $t0, $s2, copy
+	addi $s3, $s3, -1
+	bne $s3, $zero, pass
+	sw $s4, 12288
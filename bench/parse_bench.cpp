@@ -0,0 +1,120 @@
+// startup benchmark: time to turn a large generated program into decoded instructions,
+// comparing the old getline + boost::tokenizer front-end, the mmap'd single pass assembler
+// and loading a pre-assembled image
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <boost/tokenizer.hpp>
+#include "../Program.hpp"
+
+using namespace std;
+
+// the front-end the simulators used before Assembler.hpp, kept as the baseline
+struct LegacyParser
+{
+	unordered_map<string, int> address;
+	vector<vector<string>> commands;
+
+	void parseCommand(string line)
+	{
+		line = line.substr(0, line.find('#'));
+		vector<string> command;
+		boost::tokenizer<boost::char_separator<char>> tokens(line, boost::char_separator<char>(", \t"));
+		for (auto &s : tokens)
+			command.push_back(s);
+		if (command.empty())
+			return;
+		else if (command.size() == 1)
+		{
+			string label = command[0].back() == ':' ? command[0].substr(0, command[0].size() - 1) : "?";
+			address[label] = address.find(label) == address.end() ? commands.size() : -1;
+			command.clear();
+		}
+		else if (command[0].back() == ':')
+		{
+			string label = command[0].substr(0, command[0].size() - 1);
+			address[label] = address.find(label) == address.end() ? commands.size() : -1;
+			command = vector<string>(command.begin() + 1, command.end());
+		}
+		if (command.empty())
+			return;
+		command.resize(4);
+		commands.push_back(command);
+	}
+
+	void constructCommands(ifstream &file)
+	{
+		string line;
+		while (getline(file, line))
+			parseCommand(line);
+	}
+};
+
+void generate(const char *path, int lines)
+{
+	ofstream out(path);
+	const char *body[] = {"add $t2, $t2, $t1", "lw $t3, 4($t0)  # load", "sw $t3, 8($t0)", "addi $t1, $t1, -1",
+						  "mul $t4, $t3, $t2", "slt $t5, $t4, $t3", "bne $t1, $zero, L"};
+	for (int i = 0; i < lines; ++i)
+	{
+		if (i % 7 == 0)
+			out << 'L' << i / 7 + 1 << ":\n";
+		out << body[i % 7];
+		if (i % 7 == 6)
+			out << i / 7 + 1;
+		out << '\n';
+	}
+}
+
+template <class F>
+double timeMs(F f)
+{
+	auto start = chrono::steady_clock::now();
+	f();
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+	int lines = argc > 1 ? atoi(argv[1]) : 200000;
+	const char *path = "parse_bench_input.asm";
+	generate(path, lines);
+
+	const char *imagePath = "parse_bench_input.mipo";
+	size_t legacyCount = 0, fastCount = 0, imageCount = 0;
+	double legacy = timeMs([&]
+						   {
+		ifstream file(path);
+		LegacyParser parser;
+		parser.constructCommands(file);
+		legacyCount = parser.commands.size(); });
+	double fast = timeMs([&]
+						 {
+		Program program;
+		program.load(path);
+		if (program.exitcode)
+			program.handleExit(program.exitcode, program.errorPC);
+		fastCount = program.code.size(); });
+	{
+		Program program;
+		program.load(path);
+		program.writeImage(imagePath);
+	}
+	double image = timeMs([&]
+						  {
+		Program program;
+		program.load(imagePath);
+		imageCount = program.code.size(); });
+	remove(path);
+	remove(imagePath);
+
+	cout << "Lines: " << lines << '\n';
+	cout << "Legacy tokenizer: " << legacy << " ms (" << legacyCount << " commands, not decoded)\n";
+	cout << "Assembler: " << fast << " ms (" << fastCount << " instructions decoded)\n";
+	cout << "Speedup: " << legacy / fast << "x\n";
+	cout << "Image load: " << image << " ms (" << imageCount << " instructions)\n";
+	return 0;
+}
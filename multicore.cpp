@@ -0,0 +1,383 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include "Program.hpp"
+#include "Coherence.hpp"
+#include "Options.hpp"
+
+using namespace std;
+
+struct Slot {
+	bool valid = false;
+	int pc;
+	long long seq;
+	Instruction inst;
+	int a = 0;
+	int b = 0;
+	int result = 0;
+	int result2 = 0;
+	int index = 0;
+	int offset = 0;
+};
+
+// reusable barrier, std::barrier only arrives in C++20 and the tree builds as C++17
+struct Barrier {
+	mutex m;
+	condition_variable cv;
+	int count, waiting = 0;
+	long long generation = 0;
+
+	Barrier(int count) : count(count) {}
+
+	void wait()
+	{
+		unique_lock<mutex> lock(m);
+		long long gen = generation;
+		if (++waiting == count)
+		{
+			waiting = 0;
+			++generation;
+			cv.notify_all();
+			return;
+		}
+		cv.wait(lock, [&] { return gen != generation; });
+	}
+};
+
+// a single-issue 5-stage pipeline with forwarding, its memory stage blocks for the cache latency
+struct Core
+{
+	int id;
+	Program &program;
+	CoherentMemory &memory;
+	int registers[NUM_REGISTERS] = {0};
+	int forwarded[NUM_REGISTERS] = {0};
+	int readyCycle[NUM_REGISTERS] = {0};
+	long long lastWriter[NUM_REGISTERS];
+	int PCcurr = 0;
+	bool fetchBlocked = false;
+	long long seq = 0;
+
+	Slot IF_ID, ID_EX, EX_MEM, MEM_WB;
+	// cycles the access in EX_MEM still needs, -1 when it has not started
+	int memRemaining = -1;
+
+	long long clockCycles = 0;
+	long long retired = 0;
+	long long memoryStalls = 0;
+	long long skippedCycles = 0;
+	int exitcode = 0;
+	int errorPC = -1;
+
+	Core(int id, Program &program, CoherentMemory &memory) : id(id), program(program), memory(memory)
+	{
+		PCcurr = program.entry;
+		for (int i = 0; i < NUM_REGISTERS; ++i)
+			lastWriter[i] = -1, registers[i] = forwarded[i] = i < 32 ? program.initialRegisters[i] : 0;
+		// $k0 holds the core id so copies of one program can split their work
+		registers[26] = forwarded[26] = id;
+	}
+
+	void WB_Stage()
+	{
+		if (!MEM_WB.valid)
+			return;
+		if (MEM_WB.inst.rd)
+			registers[MEM_WB.inst.rd] = MEM_WB.result;
+		if (MEM_WB.inst.rd2())
+			registers[MEM_WB.inst.rd2()] = MEM_WB.result2;
+		++retired;
+		MEM_WB.valid = false;
+	}
+
+	// returns false while the access is still waiting on the cache
+	bool MEM_Stage()
+	{
+		Slot &s = EX_MEM;
+		if (!s.valid)
+			return true;
+		if (s.inst.isMemory())
+		{
+			if (memRemaining < 0)
+			{
+				int latency;
+				if (s.inst.isLoad())
+					s.result = loadResult(s.inst, memory.read(id, s.index, latency), s.offset, program.bigEndian);
+				else
+				{
+					int size = s.inst.accessSize();
+					// sub-word stores only replace their lane so neighbouring bytes written by other cores survive
+					memory.write(id, s.index, mergeLane(0, s.b, size, s.offset, program.bigEndian), latency,
+								 laneMask(size, s.offset, program.bigEndian));
+				}
+				memRemaining = latency;
+			}
+			if (--memRemaining > 0)
+			{
+				++memoryStalls;
+				return false;
+			}
+			memRemaining = -1;
+			if (s.inst.isLoad() && lastWriter[s.inst.rd] == s.seq)
+				forwarded[s.inst.rd] = s.result;
+		}
+		MEM_WB = s;
+		s.valid = false;
+		return true;
+	}
+
+	void EX_Stage()
+	{
+		Slot &s = ID_EX;
+		if (!s.valid)
+			return;
+		if (s.inst.isMemory())
+		{
+			s.index = program.wordIndex(s.a + s.inst.imm, s.inst.accessSize());
+			s.offset = program.byteOffset(s.a + s.inst.imm);
+			if (s.index < 0)
+			{
+				exitcode = Program::INVALID_ADDRESS, errorPC = s.pc;
+				return;
+			}
+		}
+		else if (s.inst.rd)
+		{
+			s.result = aluResult(s.inst, s.a, s.b);
+			if (lastWriter[s.inst.rd] == s.seq)
+				forwarded[s.inst.rd] = s.result;
+			if (s.inst.rd2())
+			{
+				s.result2 = aluResult2(s.inst, s.a, s.b);
+				if (lastWriter[s.inst.rd2()] == s.seq)
+					forwarded[s.inst.rd2()] = s.result2;
+			}
+		}
+		EX_MEM = s;
+		s.valid = false;
+	}
+
+	void ID_Stage()
+	{
+		Slot &s = IF_ID;
+		if (!s.valid || readyCycle[s.inst.rs] > clockCycles || readyCycle[s.inst.rt] > clockCycles)
+			return;
+		s.a = forwarded[s.inst.rs];
+		s.b = forwarded[s.inst.rt];
+		if (s.inst.rd)
+		{
+			readyCycle[s.inst.rd] = clockCycles + (s.inst.isLoad() ? 2 : 1);
+			lastWriter[s.inst.rd] = s.seq;
+		}
+		if (s.inst.rd2())
+		{
+			readyCycle[s.inst.rd2()] = clockCycles + 1;
+			lastWriter[s.inst.rd2()] = s.seq;
+		}
+		if (s.inst.isControl())
+		{
+			PCcurr = program.nextPC(s.inst, s.pc, s.a, s.b);
+			fetchBlocked = false;
+			if (PCcurr < 0)
+			{
+				exitcode = Program::INVALID_ADDRESS, errorPC = s.pc;
+				PCcurr = program.code.size();
+			}
+		}
+		ID_EX = s;
+		s.valid = false;
+	}
+
+	void IF_Stage()
+	{
+		if (IF_ID.valid || fetchBlocked || PCcurr >= (int)program.code.size())
+			return;
+		IF_ID.valid = true;
+		IF_ID.pc = PCcurr;
+		IF_ID.seq = seq++;
+		IF_ID.inst = program.code[PCcurr++];
+		if (IF_ID.inst.isControl())
+			fetchBlocked = true;
+	}
+
+	bool done()
+	{
+		return exitcode != 0 || (PCcurr >= (int)program.code.size() && !fetchBlocked && !IF_ID.valid && !ID_EX.valid && !EX_MEM.valid && !MEM_WB.valid);
+	}
+
+	void cycle()
+	{
+		++clockCycles;
+		WB_Stage();
+		// a pending cache access freezes everything upstream of the memory stage
+		if (!MEM_Stage())
+			return;
+		EX_Stage();
+		if (ID_EX.valid)
+			return;
+		ID_Stage();
+		IF_Stage();
+	}
+
+	// while an access is outstanding and nothing is left to write back the core is frozen,
+	// jump to the cycle before the access completes instead of ticking through it
+	void skipFrozenCycles(long long until)
+	{
+		if (memRemaining <= 1 || MEM_WB.valid)
+			return;
+		long long skip = min<long long>(memRemaining - 1, until - clockCycles);
+		clockCycles += skip;
+		memoryStalls += skip;
+		skippedCycles += skip;
+		memRemaining -= skip;
+	}
+
+	// simulate until the end of the quantum or until the program finishes
+	void run(long long until)
+	{
+		while (clockCycles < until && !done())
+		{
+			cycle();
+			skipFrozenCycles(until);
+		}
+	}
+};
+
+struct Multicore_Architecture
+{
+	Program &program;
+	CoherentMemory memory;
+	vector<Core> cores;
+	int quantum;
+	bool finished = false;
+	long long quanta = 0;
+
+	Multicore_Architecture(Program &program, int numCores, int quantum, int sets, int lineWords, int missLatency)
+		: program(program), memory(Program::MAX >> 2, numCores, sets, lineWords, missLatency), quantum(quantum)
+	{
+		for (int c = 0; c < numCores; ++c)
+			cores.emplace_back(c, program, memory);
+		for (auto &word : program.initialData)
+			memory.data[word.first].store(word.second);
+	}
+
+	// every core runs on its own host thread, no core gets more than one quantum ahead of another.
+	// within a quantum the cores' accesses to shared memory interleave as the host schedules the
+	// threads, so a program whose cores race on the same words can end differently from run to run
+	void executeCommandsPipelined()
+	{
+		int n = cores.size();
+		Barrier barrier(n);
+		vector<thread> workers;
+		for (int c = 0; c < n; ++c)
+			workers.emplace_back([&, c]
+								 {
+				for (long long limit = quantum;; limit += quantum)
+				{
+					cores[c].run(limit);
+					barrier.wait();
+					// core 0 decides termination while everyone else waits at the second barrier
+					if (c == 0)
+					{
+						++quanta;
+						finished = true;
+						for (auto &core : cores)
+							finished = finished && core.done();
+					}
+					barrier.wait();
+					if (finished)
+						return;
+				} });
+		for (auto &w : workers)
+			w.join();
+	}
+
+	void printResults()
+	{
+		int exitcode = 0, errorPC = -1;
+		long long cycles = 0, retired = 0;
+		for (auto &core : cores)
+		{
+			for (int i = 0; i < 32; ++i)
+				cout << core.registers[i] << ' ';
+			cout << '\n';
+			cycles = max(cycles, core.clockCycles);
+			retired += core.retired;
+			if (core.exitcode && !exitcode)
+				exitcode = core.exitcode, errorPC = core.errorPC;
+		}
+		program.handleExit(exitcode, errorPC);
+		cout << "Cycles: " << cycles << '\n';
+		cout << "Instructions: " << retired << '\n';
+		cout << "Aggregate IPC: " << fixed << setprecision(3) << (cycles ? double(retired) / cycles : 0.0) << '\n';
+		cout << "Quanta: " << quanta << '\n';
+		for (auto &core : cores)
+		{
+			CoherenceCounters &c = memory.counters[core.id];
+			cout << "Core " << core.id << ": instructions " << core.retired << " cycles " << core.clockCycles
+				 << " memory stall cycles " << core.memoryStalls << " (skipped " << core.skippedCycles << ") hits " << c.hits << " misses " << c.misses
+				 << " upgrades " << c.upgrades << " invalidations " << c.invalidationsSent << " writebacks " << c.writebacks
+				 << " cache-to-cache " << c.cacheToCache << '\n';
+		}
+	}
+};
+
+const char *const SETTINGS[] = {"program", "cores", "quantum", "miss-latency", "cache-sets", "line-words"};
+const char *const POSITIONAL[] = {"program", "cores", "quantum", "miss-latency"};
+
+int main(int argc, char *argv[])
+{
+	Options options(SETTINGS);
+	bool valid = true;
+	int positional = 0;
+	for (int i = 1; i < argc && valid; ++i)
+	{
+		string arg = argv[i];
+		if (arg.rfind("--", 0) == 0)
+			valid = options.parseFlag(arg);
+		else if (positional < 4)
+			valid = options.set(POSITIONAL[positional++], arg, "argument " + to_string(i));
+		else
+		{
+			options.error = "too many arguments";
+			valid = false;
+		}
+	}
+	string file;
+	// 256 lines of 4 words, 4KB private cache per core
+	int numCores = 4, quantum = 1000, missLatency = 20, sets = 256, lineWords = 4;
+	valid = valid && options.text("program", file) && options.integer("cores", numCores, 1, 1024) && options.integer("quantum", quantum, 1, INT_MAX) &&
+			options.integer("miss-latency", missLatency, 1, 1 << 20) && options.integer("cache-sets", sets, 1, 1 << 20) && options.integer("line-words", lineWords, 1, 1024);
+	if (!valid || file.empty())
+	{
+		if (!options.error.empty())
+			std::cerr << options.error << '\n';
+		std::cerr << "Required argument: file_name\n./multicore [--key=value...] <file name> [cores] [quantum] [miss latency]\n"
+					 "settings, as --key=value or as key = value lines of a --config=file: program, cores, quantum, miss-latency, cache-sets, line-words\n"
+					 "cores run on host threads, so racing stores to shared words, and the cache counters, can differ between runs\n";
+		return 0;
+	}
+	Program program;
+	if (!program.load(file.c_str()))
+	{
+		std::cerr << "File could not be opened. Terminating...\n";
+		return 0;
+	}
+	if (program.exitcode)
+	{
+		program.handleExit(program.exitcode, program.errorPC);
+		return 0;
+	}
+	Multicore_Architecture *mips = new Multicore_Architecture(program, numCores, quantum, sets, lineWords, missLatency);
+	auto start = chrono::steady_clock::now();
+	mips->executeCommandsPipelined();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	mips->printResults();
+	cout << "Host time: " << seconds << " s\n";
+	return 0;
+}
@@ -0,0 +1,427 @@
+#include <string>
+#include <vector>
+#include <deque>
+#include <iostream>
+#include <iomanip>
+#include <climits>
+#include "Program.hpp"
+#include "BranchPredictor.hpp"
+
+using namespace std;
+
+struct ROBEntry {
+	int pc;
+	long long seq;
+	Instruction inst;
+	int ps1 = 0;     // physical register of rs
+	int ps2 = 0;     // physical register of rt
+	int pd = -1;     // physical register allocated for rd
+	int oldPd = -1;  // mapping of rd before this instruction, freed at commit
+	int pd2 = -1;    // the same for the second destination of div
+	int oldPd2 = -1;
+	bool issued = false;
+	bool done = false;
+	bool fault = false;
+	int predictedNext = 0;
+	int actualNext = 0;
+	int value = 0;   // result, or store data
+	int value2 = 0;
+	int index = -1;  // word index of a memory access
+	int offset = 0;  // byte within that word
+	bool addressKnown = false;
+	bool forwardedLoad = false;
+};
+
+struct OoO_Architecture
+{
+	Program &program;
+	ArchState state;
+	int width, robSize, iqSize, lsqSize, memPorts, loadLatency;
+
+	// rename state: speculative and retirement register alias tables over the physical file
+	int RAT[NUM_REGISTERS], RRAT[NUM_REGISTERS];
+	vector<int> prf;
+	vector<bool> prfReady;
+	deque<int> freeList;
+
+	// reorder buffer as a ring of entries, head is the oldest instruction
+	vector<ROBEntry> ROB;
+	int robHead = 0, robCount = 0;
+	// issue queue and load/store queue hold ROB indices in program order
+	vector<int> IQ;
+	deque<int> LSQ;
+	// instructions executing, completing at the given cycle
+	vector<pair<int, int>> inFlight;
+
+	deque<ROBEntry> fetchQueue;
+	int fetchPC = 0;
+	long long seq = 0;
+	SaturatingBranchPredictor predictor;
+
+	int clockCycles = 0;
+	int exitcode = 0;
+	int errorPC = -1;
+	long long retired = 0;
+	long long branches = 0;
+	long long mispredictions = 0;
+	long long loads = 0;
+	long long storeForwards = 0;
+	long long robOccupancy = 0;
+	long long dispatchStalls = 0;
+	// bumped whenever any stage does work, a cycle that leaves it unchanged is idle
+	long long events = 0;
+	long long skippedCycles = 0;
+
+	OoO_Architecture(Program &program, int width, int robSize, int loadLatency)
+		: program(program), width(width), robSize(robSize), iqSize(robSize / 2), lsqSize(robSize / 2),
+		  memPorts(max(1, width / 2)), loadLatency(loadLatency), prf(NUM_REGISTERS + 2 * robSize, 0),
+		  prfReady(NUM_REGISTERS + 2 * robSize, true),
+		  ROB(robSize), predictor(1)
+	{
+		for (int i = 0; i < NUM_REGISTERS; ++i)
+			RAT[i] = RRAT[i] = i;
+		// every instruction in the ROB may hold two physical registers (div)
+		for (int i = NUM_REGISTERS; i < (int)prf.size(); ++i)
+			freeList.push_back(i);
+		state.initialise(program);
+		copy(state.registers, state.registers + NUM_REGISTERS, prf.begin());
+		fetchPC = program.entry;
+	}
+
+	ROBEntry &rob(int i)
+	{
+		return ROB[i];
+	}
+
+	int robIndex(int offset)
+	{
+		return (robHead + offset) % robSize;
+	}
+
+	// discard everything younger than the committed state and restart fetch at pc
+	void flush(int pc)
+	{
+		robCount = 0;
+		IQ.clear();
+		LSQ.clear();
+		inFlight.clear();
+		fetchQueue.clear();
+		vector<bool> mapped(prf.size(), false);
+		for (int i = 0; i < NUM_REGISTERS; ++i)
+			RAT[i] = RRAT[i], mapped[RRAT[i]] = true;
+		freeList.clear();
+		for (int p = 0; p < (int)prf.size(); ++p)
+		{
+			if (!mapped[p])
+				freeList.push_back(p);
+			prfReady[p] = true;
+		}
+		fetchPC = pc;
+	}
+
+	// retire completed instructions in order, exceptions and branch recovery happen here so they are precise
+	void Commit_Stage()
+	{
+		for (int n = 0; n < width && robCount > 0; ++n)
+		{
+			ROBEntry &e = rob(robHead);
+			if (!e.done)
+				return;
+			if (e.fault)
+			{
+				exitcode = Program::INVALID_ADDRESS;
+				errorPC = e.pc;
+				return;
+			}
+			if (e.inst.isStore())
+			{
+				state.store(e.index, storeResult(e.inst, state.data[e.index], e.value, e.offset, program.bigEndian));
+				LSQ.pop_front();
+			}
+			else if (e.inst.isLoad())
+				LSQ.pop_front();
+			if (e.pd >= 0)
+			{
+				state.registers[e.inst.rd] = e.value;
+				RRAT[e.inst.rd] = e.pd;
+				freeList.push_back(e.oldPd);
+			}
+			if (e.pd2 >= 0)
+			{
+				state.registers[e.inst.rd2()] = e.value2;
+				RRAT[e.inst.rd2()] = e.pd2;
+				freeList.push_back(e.oldPd2);
+			}
+			robHead = (robHead + 1) % robSize;
+			--robCount;
+			++retired;
+			++events;
+			if (e.inst.isBranch())
+			{
+				++branches;
+				predictor.update(e.pc, e.actualNext != e.pc + 1);
+			}
+			if (e.actualNext != e.predictedNext)
+			{
+				++mispredictions;
+				flush(e.actualNext);
+				return;
+			}
+		}
+	}
+
+	void Complete_Stage()
+	{
+		for (int i = 0; i < (int)inFlight.size();)
+		{
+			if (inFlight[i].first > clockCycles)
+			{
+				++i;
+				continue;
+			}
+			ROBEntry &e = rob(inFlight[i].second);
+			if (e.pd >= 0)
+				prf[e.pd] = e.value, prfReady[e.pd] = true;
+			if (e.pd2 >= 0)
+				prf[e.pd2] = e.value2, prfReady[e.pd2] = true;
+			e.done = true;
+			++events;
+			inFlight[i] = inFlight.back();
+			inFlight.pop_back();
+		}
+	}
+
+	// a load may go once every older store has its address, taking the youngest matching store's data,
+	// a sub-word access overlapping an older store waits for that store to commit instead
+	bool tryLoad(ROBEntry &load)
+	{
+		const ROBEntry *match = nullptr;
+		for (int idx : LSQ)
+		{
+			ROBEntry &e = rob(idx);
+			if (e.seq >= load.seq)
+				break;
+			if (!e.inst.isStore())
+				continue;
+			if (!e.addressKnown)
+				return false;
+			if (e.index == load.index)
+			{
+				if (e.inst.accessSize() < 4 || load.inst.accessSize() < 4)
+					return false;
+				match = &e;
+			}
+		}
+		load.forwardedLoad = match != nullptr;
+		load.value = match ? match->value : loadResult(load.inst, state.data[load.index], load.offset, program.bigEndian);
+		return true;
+	}
+
+	// select the oldest ready instructions from the issue queue
+	void Issue_Stage()
+	{
+		int issued = 0, memIssued = 0;
+		for (int i = 0; i < (int)IQ.size() && issued < width;)
+		{
+			ROBEntry &e = rob(IQ[i]);
+			if (!prfReady[e.ps1] || !prfReady[e.ps2] || (e.inst.isMemory() && memIssued == memPorts))
+			{
+				++i;
+				continue;
+			}
+			int a = prf[e.ps1], b = prf[e.ps2];
+			int latency = 1;
+			if (e.inst.isMemory())
+			{
+				e.index = program.wordIndex(a + e.inst.imm, e.inst.accessSize());
+				e.offset = program.byteOffset(a + e.inst.imm);
+				if (e.index < 0)
+					e.fault = true;
+				else if (e.inst.isStore())
+				{
+					e.value = b;
+					e.addressKnown = true;
+				}
+				else
+				{
+					if (!tryLoad(e))
+					{
+						++i;
+						continue;
+					}
+					++loads;
+					if (e.forwardedLoad)
+						++storeForwards;
+					else
+						latency = loadLatency;
+				}
+				++memIssued;
+			}
+			else
+			{
+				if (e.inst.isControl())
+				{
+					e.actualNext = program.nextPC(e.inst, e.pc, a, b);
+					e.fault = e.actualNext < 0;
+				}
+				e.value = aluResult(e.inst, a, b);
+				if (e.pd2 >= 0)
+					e.value2 = aluResult2(e.inst, a, b);
+			}
+			e.issued = true;
+			inFlight.push_back({clockCycles + latency, IQ[i]});
+			IQ.erase(IQ.begin() + i);
+			++events;
+			++issued;
+		}
+	}
+
+	// rename and allocate ROB, issue queue and load/store queue entries in program order
+	void Dispatch_Stage()
+	{
+		for (int n = 0; n < width && !fetchQueue.empty(); ++n)
+		{
+			ROBEntry &f = fetchQueue.front();
+			int destinations = (f.inst.rd != 0) + (f.inst.rd2() != 0);
+			if (robCount == robSize || (int)IQ.size() == iqSize || (f.inst.isMemory() && (int)LSQ.size() == lsqSize) ||
+				(int)freeList.size() < destinations)
+			{
+				++dispatchStalls;
+				return;
+			}
+			int idx = robIndex(robCount++);
+			ROBEntry &e = rob(idx) = f;
+			fetchQueue.pop_front();
+			++events;
+			e.ps1 = RAT[e.inst.rs];
+			e.ps2 = RAT[e.inst.rt];
+			e.actualNext = e.pc + 1;
+			if (e.inst.rd)
+			{
+				e.oldPd = RAT[e.inst.rd];
+				e.pd = freeList.front();
+				freeList.pop_front();
+				prfReady[e.pd] = false;
+				RAT[e.inst.rd] = e.pd;
+			}
+			if (e.inst.rd2())
+			{
+				e.oldPd2 = RAT[e.inst.rd2()];
+				e.pd2 = freeList.front();
+				freeList.pop_front();
+				prfReady[e.pd2] = false;
+				RAT[e.inst.rd2()] = e.pd2;
+			}
+			IQ.push_back(idx);
+			if (e.inst.isMemory())
+				LSQ.push_back(idx);
+		}
+	}
+
+	// fetch along the predicted path
+	void IF_Stage()
+	{
+		for (int n = 0; n < width && (int)fetchQueue.size() < 2 * width && fetchPC < (int)program.code.size(); ++n)
+		{
+			ROBEntry e;
+			e.pc = fetchPC;
+			e.seq = seq++;
+			e.inst = program.code[fetchPC];
+			// jr is predicted not taken and always recovers at commit
+			if (e.inst.opcode == OP_J || e.inst.opcode == OP_JAL)
+				e.predictedNext = e.inst.target;
+			else if (e.inst.isBranch() && predictor.predict(fetchPC))
+				e.predictedNext = e.inst.target;
+			else
+				e.predictedNext = fetchPC + 1;
+			fetchPC = e.predictedNext;
+			fetchQueue.push_back(e);
+			++events;
+		}
+	}
+
+	bool done()
+	{
+		return fetchPC >= (int)program.code.size() && fetchQueue.empty() && robCount == 0;
+	}
+
+	void executeCommandsPipelined()
+	{
+		while (!done() && exitcode == 0)
+		{
+			long long before = events, stallsBefore = dispatchStalls;
+			++clockCycles;
+			Commit_Stage();
+			Complete_Stage();
+			Issue_Stage();
+			Dispatch_Stage();
+			IF_Stage();
+			robOccupancy += robCount;
+			state.printRegistersAndMemoryDelta();
+			if (events == before)
+				skipIdleCycles(dispatchStalls - stallsBefore);
+		}
+		program.handleExit(exitcode, errorPC);
+		printStatistics();
+	}
+
+	// an idle cycle repeats itself until the next in-flight instruction completes,
+	// so jump straight there and account for the skipped cycles in bulk
+	void skipIdleCycles(long long stallsPerCycle)
+	{
+		int next = INT_MAX;
+		for (auto &f : inFlight)
+			next = min(next, f.first);
+		if (next == INT_MAX || next - 1 <= clockCycles)
+			return;
+		long long skip = next - 1 - clockCycles;
+		clockCycles += skip;
+		skippedCycles += skip;
+		robOccupancy += skip * robCount;
+		dispatchStalls += skip * stallsPerCycle;
+		state.printUnchanged(skip);
+	}
+
+	void printStatistics()
+	{
+		cout << "Cycles: " << clockCycles << '\n';
+		cout << "Instructions: " << retired << '\n';
+		cout << "IPC: " << fixed << setprecision(3) << (clockCycles ? double(retired) / clockCycles : 0.0) << '\n';
+		cout << "Branches: " << branches << " mispredicted: " << mispredictions << '\n';
+		cout << "Loads: " << loads << " forwarded from stores: " << storeForwards << '\n';
+		cout << "Average ROB occupancy: " << (clockCycles ? double(robOccupancy) / clockCycles : 0.0) << '\n';
+		cout << "Dispatch stall cycles: " << dispatchStalls << '\n';
+		cout << "Idle cycles skipped: " << skippedCycles << '\n';
+	}
+};
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2 || argc > 5)
+	{
+		std::cerr << "Required argument: file_name\n./ooo <file name> [width] [rob size] [load latency]\n";
+		return 0;
+	}
+	int width = argc > 2 ? atoi(argv[2]) : 2;
+	int robSize = argc > 3 ? atoi(argv[3]) : 32;
+	int loadLatency = argc > 4 ? atoi(argv[4]) : 1;
+	if (width < 1 || width > 8 || robSize < 2 || loadLatency < 1)
+	{
+		std::cerr << "Width must be between 1 and 8, the ROB needs at least 2 entries and load latency at least 1 cycle\n";
+		return 0;
+	}
+	Program program;
+	if (!program.load(argv[1]))
+	{
+		std::cerr << "File could not be opened. Terminating...\n";
+		return 0;
+	}
+	if (program.exitcode)
+	{
+		program.handleExit(program.exitcode, program.errorPC);
+		return 0;
+	}
+	OoO_Architecture *mips = new OoO_Architecture(program, width, robSize, loadLatency);
+	mips->executeCommandsPipelined();
+	return 0;
+}
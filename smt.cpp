@@ -0,0 +1,330 @@
+#include <string>
+#include <vector>
+#include <deque>
+#include <iostream>
+#include <iomanip>
+#include "Program.hpp"
+
+using namespace std;
+
+// an instruction in flight, tagged with the hardware thread it belongs to
+struct Slot {
+	int thread = -1;
+	int pc;
+	long long seq;
+	Instruction inst;
+	int a = 0;
+	int b = 0;
+	int result = 0;
+	int result2 = 0;
+	int index = 0;
+	int offset = 0;
+};
+
+// per hardware thread state: everything architectural except memory
+struct ThreadContext {
+	Program *program;
+	int registers[NUM_REGISTERS] = {0};
+	int PCcurr = 0;
+	int forwarded[NUM_REGISTERS] = {0};
+	int readyCycle[NUM_REGISTERS] = {0};
+	long long lastWriter[NUM_REGISTERS];
+	deque<Slot> fetchBuffer;
+	bool fetchBlocked = false;
+	// instructions fetched but not yet retired, used by the ICOUNT policy
+	int inFlight = 0;
+	long long retired = 0;
+	bool finished = false;
+
+	ThreadContext(Program *program) : program(program), PCcurr(program->entry)
+	{
+		for (int i = 0; i < NUM_REGISTERS; ++i)
+			lastWriter[i] = -1, registers[i] = forwarded[i] = i < 32 ? program->initialRegisters[i] : 0;
+	}
+
+	bool fetchable() const
+	{
+		return !fetchBlocked && PCcurr < (int)program->code.size() && fetchBuffer.size() < 2;
+	}
+};
+
+enum FetchPolicy {
+	ROUND_ROBIN,
+	ICOUNT
+};
+
+struct SMT_Architecture
+{
+	vector<ThreadContext> threads;
+	FetchPolicy policy;
+	vector<int> data;
+	MemoryDelta memoryDelta;
+
+	Slot ID_EX, EX_MEM, MEM_WB;
+	int lastFetched = -1;
+	int lastIssued = -1;
+	long long seq = 0;
+
+	int clockCycles = 0;
+	int exitcode = 0;
+	int errorThread = -1;
+	int errorPC = -1;
+	long long retired = 0;
+	long long idleIssueCycles = 0;
+
+	SMT_Architecture(vector<Program> &programs, FetchPolicy policy) : policy(policy), data(Program::MAX >> 2, 0), memoryDelta(Program::MAX >> 2)
+	{
+		for (int t = 0; t < (int)programs.size(); ++t)
+		{
+			threads.emplace_back(&programs[t]);
+			// $k0 holds the hardware thread id so copies of one program can split their work
+			threads[t].registers[26] = threads[t].forwarded[26] = t;
+			for (auto &word : programs[t].initialData)
+				data[word.first] = word.second;
+		}
+	}
+
+	void fail(int code, const Slot &s)
+	{
+		if (exitcode == 0)
+			exitcode = code, errorThread = s.thread, errorPC = s.pc;
+	}
+
+	void WB_Stage()
+	{
+		Slot &s = MEM_WB;
+		if (s.thread < 0)
+			return;
+		ThreadContext &t = threads[s.thread];
+		if (s.inst.rd)
+			t.registers[s.inst.rd] = s.result;
+		if (s.inst.rd2())
+			t.registers[s.inst.rd2()] = s.result2;
+		--t.inFlight;
+		++t.retired;
+		++retired;
+		MEM_WB = Slot();
+	}
+
+	void MEM_Stage()
+	{
+		Slot &s = EX_MEM;
+		if (s.thread >= 0)
+		{
+			ThreadContext &t = threads[s.thread];
+			if (s.inst.isLoad())
+			{
+				s.result = loadResult(s.inst, data[s.index], s.offset, t.program->bigEndian);
+				if (t.lastWriter[s.inst.rd] == s.seq)
+					t.forwarded[s.inst.rd] = s.result;
+			}
+			else if (s.inst.isStore())
+			{
+				int value = storeResult(s.inst, data[s.index], s.b, s.offset, t.program->bigEndian);
+				if (data[s.index] != value)
+					memoryDelta.insert(s.index);
+				data[s.index] = value;
+			}
+		}
+		MEM_WB = EX_MEM;
+		EX_MEM = Slot();
+	}
+
+	void EX_Stage()
+	{
+		Slot &s = ID_EX;
+		if (s.thread >= 0)
+		{
+			ThreadContext &t = threads[s.thread];
+			if (s.inst.isMemory())
+			{
+				s.index = t.program->wordIndex(s.a + s.inst.imm, s.inst.accessSize());
+				s.offset = t.program->byteOffset(s.a + s.inst.imm);
+				if (s.index < 0)
+					fail(Program::INVALID_ADDRESS, s);
+			}
+			else if (s.inst.rd)
+			{
+				s.result = aluResult(s.inst, s.a, s.b);
+				if (t.lastWriter[s.inst.rd] == s.seq)
+					t.forwarded[s.inst.rd] = s.result;
+				if (s.inst.rd2())
+				{
+					s.result2 = aluResult2(s.inst, s.a, s.b);
+					if (t.lastWriter[s.inst.rd2()] == s.seq)
+						t.forwarded[s.inst.rd2()] = s.result2;
+				}
+			}
+		}
+		EX_MEM = ID_EX;
+		ID_EX = Slot();
+	}
+
+	bool canIssue(ThreadContext &t)
+	{
+		if (t.fetchBuffer.empty())
+			return false;
+		const Instruction &inst = t.fetchBuffer.front().inst;
+		return t.readyCycle[inst.rs] <= clockCycles && t.readyCycle[inst.rt] <= clockCycles;
+	}
+
+	// issue one instruction per cycle, rotating over the threads whose next instruction has its operands
+	void ID_Stage()
+	{
+		int K = threads.size();
+		for (int i = 1; i <= K; ++i)
+		{
+			int id = (lastIssued + i) % K;
+			ThreadContext &t = threads[id];
+			if (!canIssue(t))
+				continue;
+			Slot s = t.fetchBuffer.front();
+			t.fetchBuffer.pop_front();
+			s.a = t.forwarded[s.inst.rs];
+			s.b = t.forwarded[s.inst.rt];
+			if (s.inst.rd)
+			{
+				t.readyCycle[s.inst.rd] = clockCycles + (s.inst.isLoad() ? 2 : 1);
+				t.lastWriter[s.inst.rd] = s.seq;
+			}
+			if (s.inst.rd2())
+			{
+				t.readyCycle[s.inst.rd2()] = clockCycles + 1;
+				t.lastWriter[s.inst.rd2()] = s.seq;
+			}
+			if (s.inst.isControl())
+			{
+				t.PCcurr = t.program->nextPC(s.inst, s.pc, s.a, s.b);
+				t.fetchBlocked = false;
+				if (t.PCcurr < 0)
+				{
+					fail(Program::INVALID_ADDRESS, s);
+					t.PCcurr = t.program->code.size();
+				}
+			}
+			ID_EX = s;
+			lastIssued = id;
+			return;
+		}
+		++idleIssueCycles;
+	}
+
+	// pick the thread to fetch from according to the fetch policy
+	int selectThread()
+	{
+		int K = threads.size(), best = -1;
+		for (int i = 1; i <= K; ++i)
+		{
+			int id = (lastFetched + i) % K;
+			if (!threads[id].fetchable())
+				continue;
+			if (policy == ROUND_ROBIN)
+				return id;
+			if (best < 0 || threads[id].inFlight < threads[best].inFlight)
+				best = id;
+		}
+		return best;
+	}
+
+	// a thread stops fetching after a control instruction until it resolves in decode
+	void IF_Stage()
+	{
+		int id = selectThread();
+		if (id < 0)
+			return;
+		ThreadContext &t = threads[id];
+		Slot s;
+		s.thread = id;
+		s.pc = t.PCcurr;
+		s.seq = seq++;
+		s.inst = t.program->code[t.PCcurr++];
+		if (s.inst.isControl())
+			t.fetchBlocked = true;
+		t.fetchBuffer.push_back(s);
+		++t.inFlight;
+		lastFetched = id;
+	}
+
+	bool done()
+	{
+		for (auto &t : threads)
+			if (t.PCcurr < (int)t.program->code.size() || t.fetchBlocked || t.inFlight > 0)
+				return false;
+		return true;
+	}
+
+	void printRegistersAndMemoryDelta()
+	{
+		for (auto &t : threads)
+		{
+			for (int i = 0; i < 32; ++i)
+				cout << t.registers[i] << ' ';
+			cout << '\n';
+		}
+		cout << memoryDelta.size() << (memoryDelta.empty() ? '\n' : ' ');
+		for (int index : memoryDelta)
+			cout << index << ' ' << data[index] << '\n';
+		memoryDelta.clear();
+	}
+
+	void executeCommandsPipelined()
+	{
+		while (!done() && exitcode == 0)
+		{
+			++clockCycles;
+			WB_Stage();
+			MEM_Stage();
+			EX_Stage();
+			ID_Stage();
+			IF_Stage();
+			printRegistersAndMemoryDelta();
+		}
+		if (exitcode)
+			cerr << "Thread " << errorThread << ':';
+		threads[max(errorThread, 0)].program->handleExit(exitcode, errorPC);
+		printStatistics();
+	}
+
+	void printStatistics()
+	{
+		cout << "Cycles: " << clockCycles << '\n';
+		cout << "Instructions: " << retired << '\n';
+		cout << "IPC: " << fixed << setprecision(3) << (clockCycles ? double(retired) / clockCycles : 0.0) << '\n';
+		cout << "Idle issue cycles: " << idleIssueCycles << '\n';
+		for (int t = 0; t < (int)threads.size(); ++t)
+			cout << "Thread " << t << " instructions: " << threads[t].retired << '\n';
+	}
+};
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3)
+	{
+		std::cerr << "Required arguments: fetch_policy file_name...\n./smt <rr|icount> <file name> [file name...]\n";
+		return 0;
+	}
+	string policyName = argv[1];
+	if (policyName != "rr" && policyName != "icount")
+	{
+		std::cerr << "Fetch policy must be rr or icount\n";
+		return 0;
+	}
+	// one hardware thread per file, a file may be repeated to run several copies
+	vector<Program> programs(argc - 2);
+	for (int i = 2; i < argc; ++i)
+	{
+		if (!programs[i - 2].load(argv[i]))
+		{
+			std::cerr << "File could not be opened. Terminating...\n";
+			return 0;
+		}
+		if (programs[i - 2].exitcode)
+		{
+			programs[i - 2].handleExit(programs[i - 2].exitcode, programs[i - 2].errorPC);
+			return 0;
+		}
+	}
+	SMT_Architecture *mips = new SMT_Architecture(programs, policyName == "rr" ? ROUND_ROBIN : ICOUNT);
+	mips->executeCommandsPipelined();
+	return 0;
+}
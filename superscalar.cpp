@@ -0,0 +1,278 @@
+#include <string>
+#include <vector>
+#include <deque>
+#include <iostream>
+#include <iomanip>
+#include "Program.hpp"
+
+using namespace std;
+
+// an instruction in flight together with the values it carries down the pipeline
+struct Slot {
+	int pc;
+	long long seq;
+	Instruction inst;
+	int a = 0;
+	int b = 0;
+	int result = 0;
+	int result2 = 0;
+	int index = 0;
+	int offset = 0;
+};
+
+// functional unit classes used for the per-port structural limits
+enum Port {
+	PORT_ALU = 0,
+	PORT_MUL,
+	PORT_MEM,
+	PORT_BRANCH,
+	NUM_PORTS
+};
+
+struct Superscalar_Architecture
+{
+	Program &program;
+	ArchState state;
+	int width;
+	int ports[NUM_PORTS];
+
+	// bypass network: the latest value produced for each register
+	int forwarded[NUM_REGISTERS] = {0};
+	// first cycle in which a consumer of each register may issue
+	int readyCycle[NUM_REGISTERS] = {0};
+	// youngest in-flight writer of each register, older writers must not update forwarded
+	long long lastWriter[NUM_REGISTERS] = {0};
+
+	deque<Slot> IF_ID;
+	vector<Slot> ID_EX, EX_MEM, MEM_WB;
+	int fetchPC = 0;
+	bool fetchBlocked = false;
+	long long seq = 0;
+
+	int clockCycles = 0;
+	int exitcode = 0;
+	int errorPC = -1;
+	long long retired = 0;
+	long long rawStalls = 0;
+	long long structuralStalls = 0;
+	vector<long long> issueHistogram;
+
+	Superscalar_Architecture(Program &program, int width, int memPorts) : program(program), width(width), issueHistogram(width + 1, 0)
+	{
+		ports[PORT_ALU] = width;
+		ports[PORT_MUL] = 1;
+		ports[PORT_MEM] = memPorts;
+		ports[PORT_BRANCH] = 1;
+		for (int i = 0; i < NUM_REGISTERS; ++i)
+			lastWriter[i] = -1;
+		state.initialise(program);
+		copy(state.registers, state.registers + NUM_REGISTERS, forwarded);
+		fetchPC = program.entry;
+	}
+
+	static Port portOf(const Instruction &inst)
+	{
+		if (inst.isMemory())
+			return PORT_MEM;
+		if (inst.isControl())
+			return PORT_BRANCH;
+		if (inst.opcode == OP_MUL || inst.opcode == OP_DIV || inst.opcode == OP_MUL_PH || inst.opcode == OP_MUL_S_PH)
+			return PORT_MUL;
+		return PORT_ALU;
+	}
+
+	void fail(int code, int pc)
+	{
+		if (exitcode == 0)
+			exitcode = code, errorPC = pc;
+	}
+
+	void WB_Stage()
+	{
+		for (auto &s : MEM_WB)
+		{
+			if (s.inst.rd)
+				state.registers[s.inst.rd] = s.result;
+			if (s.inst.rd2())
+				state.registers[s.inst.rd2()] = s.result2;
+			++retired;
+		}
+		MEM_WB.clear();
+	}
+
+	void MEM_Stage()
+	{
+		// memory operations of a group are performed in program order
+		for (auto &s : EX_MEM)
+		{
+			if (s.inst.isLoad())
+			{
+				s.result = loadResult(s.inst, state.data[s.index], s.offset, program.bigEndian);
+				if (lastWriter[s.inst.rd] == s.seq)
+					forwarded[s.inst.rd] = s.result;
+			}
+			else if (s.inst.isStore())
+				state.store(s.index, storeResult(s.inst, state.data[s.index], s.b, s.offset, program.bigEndian));
+		}
+		MEM_WB.swap(EX_MEM);
+		EX_MEM.clear();
+	}
+
+	void EX_Stage()
+	{
+		for (auto &s : ID_EX)
+		{
+			if (s.inst.isMemory())
+			{
+				s.index = program.wordIndex(s.a + s.inst.imm, s.inst.accessSize());
+				s.offset = program.byteOffset(s.a + s.inst.imm);
+				if (s.index < 0)
+					fail(Program::INVALID_ADDRESS, s.pc);
+			}
+			else if (s.inst.rd)
+			{
+				s.result = aluResult(s.inst, s.a, s.b);
+				if (lastWriter[s.inst.rd] == s.seq)
+					forwarded[s.inst.rd] = s.result;
+				if (s.inst.rd2())
+				{
+					s.result2 = aluResult2(s.inst, s.a, s.b);
+					if (lastWriter[s.inst.rd2()] == s.seq)
+						forwarded[s.inst.rd2()] = s.result2;
+				}
+			}
+		}
+		EX_MEM.swap(ID_EX);
+		ID_EX.clear();
+	}
+
+	// issue up to width instructions in order, stopping at the first one that cannot go
+	void ID_Stage()
+	{
+		int used[NUM_PORTS] = {0};
+		int issued = 0;
+		while (issued < width && !IF_ID.empty())
+		{
+			Slot &s = IF_ID.front();
+			// a producer issued earlier in this group leaves its register not ready until next cycle
+			if (readyCycle[s.inst.rs] > clockCycles || readyCycle[s.inst.rt] > clockCycles)
+			{
+				++rawStalls;
+				break;
+			}
+			Port port = portOf(s.inst);
+			if (used[port] == ports[port])
+			{
+				++structuralStalls;
+				break;
+			}
+			++used[port];
+			s.a = forwarded[s.inst.rs];
+			s.b = forwarded[s.inst.rt];
+			if (s.inst.rd)
+			{
+				readyCycle[s.inst.rd] = clockCycles + (s.inst.isLoad() ? 2 : 1);
+				lastWriter[s.inst.rd] = s.seq;
+			}
+			if (s.inst.rd2())
+			{
+				readyCycle[s.inst.rd2()] = clockCycles + 1;
+				lastWriter[s.inst.rd2()] = s.seq;
+			}
+			if (s.inst.isControl())
+			{
+				// branches resolve in decode, fetch resumes at the resolved target this cycle
+				fetchPC = program.nextPC(s.inst, s.pc, s.a, s.b);
+				fetchBlocked = false;
+				if (fetchPC < 0)
+				{
+					fail(Program::INVALID_ADDRESS, s.pc);
+					fetchPC = program.code.size();
+				}
+			}
+			ID_EX.push_back(s);
+			IF_ID.pop_front();
+			++issued;
+		}
+		++issueHistogram[issued];
+	}
+
+	// fetch sequentially up to the decode width, a group ends at the first control instruction
+	void IF_Stage()
+	{
+		while ((int)IF_ID.size() < width && !fetchBlocked && fetchPC < (int)program.code.size())
+		{
+			Slot s;
+			s.pc = fetchPC;
+			s.seq = seq++;
+			s.inst = program.code[fetchPC++];
+			IF_ID.push_back(s);
+			if (s.inst.isControl())
+				fetchBlocked = true;
+		}
+	}
+
+	bool done()
+	{
+		return fetchPC >= (int)program.code.size() && !fetchBlocked && IF_ID.empty() && ID_EX.empty() && EX_MEM.empty() && MEM_WB.empty();
+	}
+
+	void executeCommandsPipelined()
+	{
+		while (!done() && exitcode == 0)
+		{
+			++clockCycles;
+			WB_Stage();
+			MEM_Stage();
+			EX_Stage();
+			ID_Stage();
+			IF_Stage();
+			state.printRegistersAndMemoryDelta();
+		}
+		program.handleExit(exitcode, errorPC);
+		printStatistics();
+	}
+
+	void printStatistics()
+	{
+		cout << "Cycles: " << clockCycles << '\n';
+		cout << "Instructions: " << retired << '\n';
+		cout << "IPC: " << fixed << setprecision(3) << (clockCycles ? double(retired) / clockCycles : 0.0) << '\n';
+		cout << "RAW stall cycles: " << rawStalls << '\n';
+		cout << "Structural stall cycles: " << structuralStalls << '\n';
+		cout << "Issue width histogram:";
+		for (int i = 0; i <= width; ++i)
+			cout << ' ' << i << ':' << issueHistogram[i];
+		cout << '\n';
+	}
+};
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2 || argc > 4)
+	{
+		std::cerr << "Required argument: file_name\n./superscalar <file name> [width] [memory ports]\n";
+		return 0;
+	}
+	int width = argc > 2 ? atoi(argv[2]) : 2;
+	int memPorts = argc > 3 ? atoi(argv[3]) : 1;
+	if (width < 1 || width > 8 || memPorts < 1)
+	{
+		std::cerr << "Width must be between 1 and 8 and at least one memory port is required\n";
+		return 0;
+	}
+	Program program;
+	if (!program.load(argv[1]))
+	{
+		std::cerr << "File could not be opened. Terminating...\n";
+		return 0;
+	}
+	if (program.exitcode)
+	{
+		program.handleExit(program.exitcode, program.errorPC);
+		return 0;
+	}
+	Superscalar_Architecture *mips = new Superscalar_Architecture(program, width, memPorts);
+	mips->executeCommandsPipelined();
+	return 0;
+}
@@ -0,0 +1,14 @@
+# a DMA copy whose length is close to INT_MAX, so source + length would wrap around past zero.
+# the engine must refuse it, and the status read back into $t1 is 2 (FAILED)
+	lui $s0, 15
+	ori $s0, $s0, 65280
+	addi $t0, $zero, 8192
+	sw $t0, 16($s0)
+	addi $t0, $zero, 16384
+	sw $t0, 20($s0)
+	lui $t0, 32767
+	ori $t0, $t0, 61440
+	sw $t0, 24($s0)
+	addi $t0, $zero, 1
+	sw $t0, 28($s0)
+	lw $t1, 28($s0)
@@ -0,0 +1,77 @@
+// checks the SSE2 packed operations against the one-lane-at-a-time fallback: one case per operation
+// with its result worked out by hand, at the wrap-around and saturation boundaries of its lanes, then
+// every pair of words built from boundary lanes and a run of pseudo-random operands
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include "../Packed.hpp"
+
+using namespace std;
+
+struct Case
+{
+	packed::Op op;
+	uint32_t a, b, expected;
+};
+
+const Case CASES[] = {
+	{packed::ADDU_QB, 0xff807f01, 0x01808001, 0x0000ff02},
+	{packed::ADDU_S_QB, 0xff807f01, 0x01808001, 0xffffff02},
+	{packed::SUBU_QB, 0x00017f80, 0x01028001, 0xffffff7f},
+	{packed::SUBU_S_QB, 0x00017f80, 0x01028001, 0x0000007f},
+	{packed::ADDQ_PH, 0x7fff8000, 0x0001ffff, 0x80007fff},
+	{packed::ADDQ_S_PH, 0x7fff8000, 0x0001ffff, 0x7fff8000},
+	{packed::SUBQ_PH, 0x80007fff, 0x0001ffff, 0x7fff8000},
+	{packed::SUBQ_S_PH, 0x80007fff, 0x0001ffff, 0x80007fff},
+	{packed::ADDU_PH, 0xffff0001, 0x0001fffe, 0x0000ffff},
+	{packed::ADDU_S_PH, 0xffff0001, 0x0001fffe, 0xffffffff},
+	{packed::SUBU_PH, 0x00000005, 0x00010002, 0xffff0003},
+	{packed::SUBU_S_PH, 0x00000005, 0x00010002, 0x00000003},
+	{packed::MUL_PH, 0x80000003, 0xffff7fff, 0x80007ffd},
+	{packed::MUL_S_PH, 0x80000003, 0xffff7fff, 0x7fff7fff},
+};
+
+int failures = 0;
+
+void check(packed::Op op, uint32_t a, uint32_t b)
+{
+	int vector = packed::apply(op, int(a), int(b)), scalar = packed::applyScalar(op, int(a), int(b));
+	if (vector != scalar && ++failures <= 10)
+		printf("%s 0x%08x, 0x%08x: 0x%08x with SSE2, 0x%08x without\n", packed::names[op], a, b, uint32_t(vector), uint32_t(scalar));
+}
+
+int main()
+{
+	for (const Case &c : CASES)
+	{
+		int scalar = packed::applyScalar(c.op, int(c.a), int(c.b));
+		if (uint32_t(scalar) != c.expected && ++failures <= 10)
+			printf("%s 0x%08x, 0x%08x: 0x%08x, expected 0x%08x\n", packed::names[c.op], c.a, c.b, uint32_t(scalar), c.expected);
+		check(c.op, c.a, c.b);
+	}
+
+	// the edges of byte and halfword lanes, repeated across the word and mixed within it
+	const uint32_t lanes[] = {0x00, 0x01, 0x7f, 0x80, 0xfe, 0xff, 0x0000, 0x0001, 0x7fff, 0x8000, 0xfffe, 0xffff};
+	vector<uint32_t> words;
+	for (uint32_t x : lanes)
+		for (uint32_t y : lanes)
+			words.push_back(x <= 0xff && y <= 0xff ? x | y << 8 | x << 16 | y << 24 : x | y << 16);
+	for (int op = 0; op < packed::NUM_OPS; ++op)
+		for (uint32_t a : words)
+			for (uint32_t b : words)
+				check(packed::Op(op), a, b);
+
+	uint32_t seed = 12345;
+	auto next = [&seed]()
+	{ return seed = seed * 1664525 + 1013904223; };
+	for (int i = 0; i < 100000; ++i)
+	{
+		uint32_t a = next(), b = next();
+		for (int op = 0; op < packed::NUM_OPS; ++op)
+			check(packed::Op(op), a, b);
+	}
+
+	if (failures)
+		printf("%d packed results differ\n", failures);
+	return failures != 0;
+}
@@ -0,0 +1,47 @@
+# every instruction with a 32-bit encoding, run as text, as an ELF executable and as an image by
+# make test. $sp and $ra are set first since an ELF starts with them pointing at the stack and past the code
+	addi $sp, $zero, 8192
+	addi $ra, $zero, 0
+	addi $s0, $zero, 4096
+	lui $t0, 4660
+	ori $t0, $t0, 22136
+	addi $t1, $zero, -7
+	add $t2, $t0, $t1
+	sub $t3, $t1, $t0
+	mul $t4, $t1, $t1
+	slt $t5, $t1, $t0
+	slti $t6, $t1, -8
+	and $t7, $t0, $t1
+	or $s1, $t0, $t1
+	xor $s2, $t0, $t1
+	nor $s3, $t0, $t1
+	andi $s4, $t0, 65280
+	sll $s5, $t1, 4
+	srl $s6, $t1, 28
+	sra $s7, $t1, 1
+	div $t0, $t1
+	mfhi $t8
+	mflo $t9
+	sw $t0, 0($s0)
+	sh $t1, 6($s0)
+	sb $t1, 9($s0)
+	lw $a0, 0($s0)
+	lh $a1, 6($s0)
+	lhu $a2, 6($s0)
+	lb $a3, 9($s0)
+	lbu $v0, 9($s0)
+	addq.ph $v1, $t0, $t1
+	addu.qb $k0, $t0, $t1
+	subu_s.qb $k1, $t1, $t0
+	addi $gp, $zero, 3
+loop: addi $gp, $gp, -1
+	jal leaf
+	bne $gp, $zero, loop
+	beq $gp, $zero, done
+	addi $at, $zero, 99
+leaf: addi $s8, $s8, 5
+	jr $ra
+done: sw $s8, 12($s0)
+	j end
+	addi $at, $zero, 98
+end: sw $ra, 16($s0)
@@ -0,0 +1,7 @@
+# run with --unified: the store overwrites the addi at byte 12 with 0 before it is fetched. the zero
+# word decodes to sll $zero, $zero, 0, the MIPS nop, so $t1 keeps 7 and $t3 ends up as 8
+	addi $t1, $zero, 7
+	sw $zero, 12($zero)
+	addi $t2, $zero, 1
+	addi $t1, $zero, 99
+	add $t3, $t1, $t2